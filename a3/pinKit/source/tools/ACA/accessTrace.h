@@ -0,0 +1,99 @@
+#ifndef _ACCESS_TRACE_H_
+#define _ACCESS_TRACE_H_
+
+#include <stdint.h>
+#include <cstring>
+#include <iostream>
+
+//L1 access stream recorded by dbpSim (-trace) and replayed by cacheReplay
+//file layout: TRACE_MAGIC followed by raw TraceRec records (gzip compressed)
+
+#define TRACE_MAGIC     "#dbpSim access trace v1\n"
+#define TRACE_MAGIC_LEN (sizeof(TRACE_MAGIC) - 1)
+#define TRACE_BUF_RECS  4096
+
+//access kinds
+enum TraceType
+{
+  TR_IFETCH = 0, TR_READ = 1, TR_WRITE = 2
+};
+
+struct TraceRec
+{
+  uint64_t addr;
+  uint64_t pc;
+  uint32_t type;
+  uint32_t pad;
+};
+
+//buffered record writer; flushes every TRACE_BUF_RECS records
+class traceWriter
+{
+  std::ostream * out;
+  TraceRec buf[TRACE_BUF_RECS];
+  int n_buf;
+
+public :
+  traceWriter() : out(0), n_buf(0) {}
+
+  void open(std::ostream * o)
+  {
+    out = o;
+    out->write(TRACE_MAGIC, TRACE_MAGIC_LEN);
+  }
+
+  bool is_open() { return out != 0; }
+
+  void record(uint64_t addr, uint64_t pc, uint32_t type)
+  {
+    TraceRec & r = buf[n_buf++];
+    r.addr = addr;
+    r.pc = pc;
+    r.type = type;
+    r.pad = 0;
+    if (n_buf == TRACE_BUF_RECS)
+      flush();
+  }
+
+  void flush()
+  {
+    out->write((const char *) buf, n_buf * sizeof(TraceRec));
+    n_buf = 0;
+  }
+};
+
+//buffered record reader; next() returns false at the end of the trace
+class traceReader
+{
+  std::istream * in;
+  TraceRec buf[TRACE_BUF_RECS];
+  int n_buf;
+  int pos;
+
+public :
+  traceReader() : in(0), n_buf(0), pos(0) {}
+
+  bool open(std::istream * i)
+  {
+    char magic[TRACE_MAGIC_LEN];
+    in = i;
+    in->read(magic, TRACE_MAGIC_LEN);
+    return in->gcount() == (std::streamsize) TRACE_MAGIC_LEN && memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN) == 0;
+  }
+
+  bool next(TraceRec & r)
+  {
+    if (pos == n_buf)
+    {
+      in->read((char *) buf, sizeof(buf));
+      n_buf = in->gcount() / sizeof(TraceRec);
+      pos = 0;
+      if (n_buf == 0)
+        return false;
+    }
+    r = buf[pos++];
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * cacheBench: throughput of the cache simulator on synthetic access streams
+ *
+ * Every generator's stream is built up front, then replayed through a fresh L1-D/L2
+ * hierarchy for each combination of configuration, replacement policy, DBP on/off and
+ * TCP on/off. Only the replay is timed. Each run is a forked child, so its peak RSS
+ * (from wait4) covers that run alone: the simulator state plus the pages of the shared
+ * stream it touched. Reported per run: accesses/s, ns/access, the miss rates (a
+ * functional sanity check) and the peak RSS.
+ *
+ * Generators (footprint -fp KB, 8-byte accesses, 30% writes, 16 PCs):
+ *   seq    : sequential sweep
+ *   stride : 65-block stride sweep (every set, no spatial reuse)
+ *   random : uniform random blocks
+ *   chase  : pointer chase through a random cyclic permutation of the blocks
+ *   zipf   : Zipf(0.99) popularity over randomly placed blocks
+ */
+
+#include "cacheSim.h"
+#include "dbpAndPrefetch.h"
+#include "replPolicy.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_BLOCK   64
+#define BENCH_NUM_PCS 16
+#define BENCH_WR_PCT  30
+#define ZIPF_S        0.99
+
+struct benchAccess
+{
+  size_t addr;
+  size_t pc;
+  bool wr;
+};
+
+struct benchConfig
+{
+  const char * name;
+  int l1s, l1w;
+  int l2s, l2w;
+};
+
+//dbpSim's default geometry and a smaller, more associative pair
+static const benchConfig CONFIGS[] = {
+  { "default", 64, 4, 1024, 16 },
+  { "small",   32, 8,  256,  8 },
+};
+#define NUM_CONFIGS ((int) (sizeof(CONFIGS) / sizeof(CONFIGS[0])))
+
+static const char * GENERATORS[] = { "seq", "stride", "random", "chase", "zipf" };
+#define NUM_GENERATORS ((int) (sizeof(GENERATORS) / sizeof(GENERATORS[0])))
+
+//xorshift64*: fast and reproducible across platforms
+struct benchRng
+{
+  unsigned long long s;
+  explicit benchRng(unsigned long long seed) : s(seed) {}
+  unsigned long long next()
+  {
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    return s * 2685821657736338717ULL;
+  }
+  size_t below(size_t n) { return (size_t) (next() % n); }
+};
+
+static void generate(const std::string & gen, size_t n, size_t footprint_kb, std::vector<benchAccess> & out)
+{
+  size_t blocks = footprint_kb * 1024 / BENCH_BLOCK;
+  size_t base = 0x10000000;
+  benchRng rng(0x9E3779B97F4A7C15ULL);
+  out.resize(n);
+
+  std::vector<size_t> perm;
+  std::vector<double> cdf;
+  if (gen == "chase" || gen == "zipf")
+  {
+    perm.resize(blocks);
+    for (size_t i = 0; i < blocks; i++)
+      perm[i] = i;
+    //Sattolo: a single cycle through all blocks
+    for (size_t i = blocks - 1; i > 0; i--)
+      std::swap(perm[i], perm[rng.below(i)]);
+  }
+  if (gen == "zipf")
+  {
+    cdf.resize(blocks);
+    double sum = 0;
+    for (size_t i = 0; i < blocks; i++)
+    {
+      sum += 1.0 / pow((double) (i + 1), ZIPF_S);
+      cdf[i] = sum;
+    }
+    for (size_t i = 0; i < blocks; i++)
+      cdf[i] /= sum;
+  }
+
+  size_t pos = 0;
+  size_t blk = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t addr;
+    if (gen == "seq")
+    {
+      addr = base + pos;
+      pos = (pos + 8) % (blocks * BENCH_BLOCK);
+    }
+    else if (gen == "stride")
+    {
+      addr = base + blk * BENCH_BLOCK;
+      blk = (blk + 65) % blocks;
+    }
+    else if (gen == "random")
+      addr = base + rng.below(blocks) * BENCH_BLOCK + 8 * rng.below(BENCH_BLOCK / 8);
+    else if (gen == "chase")
+    {
+      blk = perm[blk];
+      addr = base + blk * BENCH_BLOCK;
+    }
+    else
+    {
+      double u = (double) (rng.next() >> 11) / (double) (1ULL << 53);
+      size_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+      addr = base + perm[std::min(rank, blocks - 1)] * BENCH_BLOCK;
+    }
+    out[i].addr = addr;
+    out[i].pc = 0x400000 + 4 * (i % BENCH_NUM_PCS);
+    out[i].wr = (rng.below(100) < BENCH_WR_PCT);
+  }
+}
+
+struct benchResult
+{
+  double secs;
+  double l1_miss_rate;
+  double l2_miss_rate;
+  long rss_kb;   //peak RSS of the run (0: not measured)
+};
+
+static benchResult simulate(const benchConfig & cfg, replKind repl, bool dbp, bool tcp, const std::vector<benchAccess> & stream)
+{
+  dbpTables * tbl = new dbpTables();
+  cacheSim * l2 = new cacheSim(cfg.l2s, BENCH_BLOCK, cfg.l2w, 0);
+  cacheSim * l1 = new cacheSim(cfg.l1s, BENCH_BLOCK, cfg.l1w, l2);
+  l2->dbp_use_refcount = true;
+  l1->dbp_enable = l2->dbp_enable = dbp;
+  l1->dbp_tbl = l2->dbp_tbl = tbl;
+  l1->repl = l2->repl = repl;
+  TcpEnabled = tcp;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < stream.size(); i++)
+    l1->access(stream[i].addr, stream[i].pc, stream[i].wr);
+  benchResult r;
+  r.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  r.l1_miss_rate = l1->get_access_cnt() ? (double) l1->get_miss_cnt() / l1->get_access_cnt() : 0.0;
+  r.l2_miss_rate = l2->get_access_cnt() ? (double) l2->get_miss_cnt() / l2->get_access_cnt() : 0.0;
+  r.rss_kb = 0;
+  delete l1;
+  delete l2;
+  delete tbl;
+  return r;
+}
+
+//simulate in a child process and collect its peak RSS; in-process if fork fails
+static benchResult run(const benchConfig & cfg, replKind repl, bool dbp, bool tcp, const std::vector<benchAccess> & stream)
+{
+  int fds[2];
+  pid_t pid = -1;
+  if (pipe(fds) == 0 && (pid = fork()) == 0)
+  {
+    close(fds[0]);
+    benchResult r = simulate(cfg, repl, dbp, tcp, stream);
+    ssize_t ok = write(fds[1], &r, sizeof(r));
+    _exit(ok == (ssize_t) sizeof(r) ? 0 : 1);
+  }
+  if (pid < 0)
+    return simulate(cfg, repl, dbp, tcp, stream);
+
+  close(fds[1]);
+  benchResult r;
+  ssize_t got = read(fds[0], &r, sizeof(r));
+  close(fds[0]);
+  int status;
+  struct rusage ru;
+  if (wait4(pid, &status, 0, &ru) < 0 || got != (ssize_t) sizeof(r))
+  {
+    std::cerr << "cacheBench: benchmark child failed" << std::endl;
+    exit(1);
+  }
+  r.rss_kb = ru.ru_maxrss;
+  return r;
+}
+
+static bool in_list(const std::string & list, const std::string & item)
+{
+  if (list == "all")
+    return true;
+  std::string padded = "," + list + ",";
+  return padded.find("," + item + ",") != std::string::npos;
+}
+
+static int usage()
+{
+  std::cerr << "usage: cacheBench [-n accesses] [-fp footprint KB] [-gen seq,stride,random,chase,zipf|all]"
+               " [-repl lru,srrip,drrip,ship,dbp|all] [-cfg default,small|all] [-quick 0|1]" << std::endl;
+  return -1;
+}
+
+int main(int argc, char *argv[])
+{
+  long n = 1000000;
+  long footprint_kb = 4096;
+  std::string gens = "all", repls = "all", cfgs = "all";
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 >= argc)
+      return usage();
+    std::string opt(argv[i]);
+    const char * val = argv[++i];
+    if (opt == "-n") n = atol(val);
+    else if (opt == "-fp") footprint_kb = atol(val);
+    else if (opt == "-gen") gens = val;
+    else if (opt == "-repl") repls = val;
+    else if (opt == "-cfg") cfgs = val;
+    else if (opt == "-quick") { if (atoi(val)) n = 30000; }
+    else return usage();
+  }
+  if (n <= 0 || footprint_kb * 1024 < BENCH_BLOCK * 2)
+    return usage();
+
+  char line[256];
+  snprintf(line, sizeof(line), "%-7s %-8s %-6s %3s %3s %12s %8s %9s %9s %12s",
+           "GEN", "CONFIG", "REPL", "DBP", "TCP", "ACCESSES/S", "NS/ACC", "L1 MISS%", "L2 MISS%", "PEAK RSS(KB)");
+  std::cout << "cacheBench: " << n << " accesses per run, " << footprint_kb << " KB footprint" << std::endl;
+  std::cout << line << std::endl;
+
+  double total_secs = 0;
+  long runs = 0;
+  std::vector<benchAccess> stream;
+  for (int g = 0; g < NUM_GENERATORS; g++)
+  {
+    if (!in_list(gens, GENERATORS[g]))
+      continue;
+    generate(GENERATORS[g], (size_t) n, (size_t) footprint_kb, stream);
+    for (int c = 0; c < NUM_CONFIGS; c++)
+    {
+      if (!in_list(cfgs, CONFIGS[c].name))
+        continue;
+      for (int k = 0; k < NUM_REPL; k++)
+      {
+        if (!in_list(repls, repl_name((replKind) k)))
+          continue;
+        //TCP lives in the DBP tables: off/off, on/off, on/on
+        for (int mode = 0; mode < 3; mode++)
+        {
+          bool dbp = (mode > 0);
+          bool tcp = (mode == 2);
+          benchResult r = run(CONFIGS[c], (replKind) k, dbp, tcp, stream);
+          total_secs += r.secs;
+          runs++;
+          snprintf(line, sizeof(line), "%-7s %-8s %-6s %3s %3s %12.0f %8.1f %9.2f %9.2f %12ld",
+                   GENERATORS[g], CONFIGS[c].name, repl_name((replKind) k), dbp ? "on" : "off", tcp ? "on" : "off",
+                   r.secs > 0 ? n / r.secs : 0.0, 1e9 * r.secs / n, 100.0 * r.l1_miss_rate, 100.0 * r.l2_miss_rate, r.rss_kb);
+          std::cout << line << std::endl;
+        }
+      }
+    }
+  }
+
+  std::cout << "RUNS: " << runs << ", SIMULATION TIME: " << total_secs << " s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,585 @@
+/*
+ * cacheReplay: standalone (non-Pin) driver that replays an L1 access trace recorded with
+ * dbpSim -trace through the same L1-I/L1-D/L2 cacheSim hierarchy as dbpSim.
+ *
+ * -threads N (N > 1) enables the set-partitioned parallel mode: L1 filtering stays in
+ * order on the front thread, and the L1 miss/write-back streams are fanned out by L2 set
+ * index to N worker threads through SPSC queues. Every worker owns the L2 sets
+ * (set_idx % N == worker) plus private DBP/TCP tables; since L2 sets never interact and
+ * each set sees its requests in the original order, the merged stats are bit-identical
+ * to the sequential run. That does not hold for policies with state shared by all sets
+ * (drrip, ship, dbp: see repl_shares_state), so those cannot be combined with -threads.
+ *
+ * -repl <policy> selects the replacement policy of all levels; -repl all replays every
+ * trace once per policy and reports the miss reduction of each level against LRU.
+ * Several -t options may be given to compare a set of workload traces.
+ *
+ * -pfl1 / -pfl2 attach prefetch engines (see prefetcher.h) to L1-D / L2. L2 engines
+ * need the whole L2 access stream and therefore cannot be combined with -threads.
+ *
+ * -timing 1 enables the latency/MSHR model (timingModel.h) with the dbpSim default
+ * latencies; instruction fetch records stand for instructions. Sequential mode only.
+ *
+ * -hier <file> replays through a hierarchy file (see hierBuilder.h) instead of the
+ * -l1x/-l2x geometry; it needs the sequential mode and a single policy.
+ *
+ * -sample period:unit:warm replays SMARTS-style (see sampling.h): per period of
+ * instruction fetch records, `warm` detailed warming and `unit` measured instructions,
+ * functional warming in between (-smpfw 0 skips it). Sequential mode without -timing.
+ *
+ * -wbb N adds N-entry write-back buffers to the L1-D and the L2. The L2 buffer holds
+ * write-backs of all sets, so it cannot be combined with -threads.
+ */
+#include "cacheSim.h"
+#include "gzstream.hpp"
+#include "dbpAndPrefetch.h"
+#include "accessTrace.h"
+#include "spscQueue.h"
+#include "hierBuilder.h"
+#include "sampling.h"
+#include "tlbSim.h"
+#include "wbBuffer.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#define SHARD_QUEUE_SIZE (1 << 16)
+
+struct replayConfig
+{
+  std::vector<std::string> trace_files;
+  int l1s, l1b, l1w;
+  int l2s, l2b, l2w;
+  int tcp;
+  int threads;
+  std::string repl;
+  std::string pf_l1, pf_l2;
+  int pf_delay;
+  int timing;
+  int mem_lat;
+  std::string hier;
+  long smp_period, smp_unit, smp_warm;   //smp_period 0: no sampling
+  int smp_fw;
+  int tlb;
+  int thp;
+  int wbb;        //write-back buffer entries of the L1-D and the L2 (0: none)
+  int vc;         //victim cache entries of the L1-D (0: none)
+  int wb_train;
+
+  replayConfig() : l1s(64), l1b(64), l1w(4), l2s(1024), l2b(64), l2w(16), tcp(0), threads(1), repl("lru"), pf_delay(PF_FILL_DELAY),
+                   timing(0), mem_lat(200), smp_period(0), smp_unit(0), smp_warm(0), smp_fw(1), tlb(0), thp(0),
+                   wbb(0), vc(0), wb_train(1) {}
+};
+
+//caches and run info of one replay
+struct replayResult
+{
+  cacheSim * l1i;
+  cacheSim * l1d;
+  cacheSim * l2;
+  timingModel * timing;
+  smartsSampler * sampler;
+  mmuSim * mmu;
+  long rec_cnt;
+  double secs;
+
+  replayResult() : l1i(0), l1d(0), l2(0), timing(0), sampler(0), mmu(0), rec_cnt(0), secs(0) {}
+  ~replayResult() { delete l1i; delete l1d; delete l2; delete timing; delete sampler; delete mmu; }
+};
+
+//L2 request forwarded from the front thread to a worker
+struct L2Req
+{
+  uint64_t addr;
+  uint64_t pc;
+  bool wr_access;
+  bool wb;
+  bool done;
+};
+
+//one worker thread owning a subset of the L2 sets
+struct l2Shard
+{
+  cacheSim * l2;
+  dbpTables tbl;
+  spscQueue<L2Req> queue;
+  std::thread worker;
+
+  l2Shard(const replayConfig & cfg, replKind repl) : queue(SHARD_QUEUE_SIZE)
+  {
+    l2 = new cacheSim(cfg.l2s, cfg.l2b, cfg.l2w, 0);
+    l2->dbp_use_refcount = true;
+    l2->repl = repl;
+    l2->dbp_tbl = &tbl;
+    l2->wb_train = (cfg.wb_train != 0);
+  }
+  ~l2Shard() { delete l2; }
+
+  void run()
+  {
+    while (true)
+    {
+      L2Req req = queue.pop();
+      if (req.done)
+        break;
+      l2->access(req.addr, req.pc, req.wr_access, req.wb);
+    }
+  }
+};
+
+//routes L1 requests to the shard owning their L2 set
+class l2FanOut : public missSink
+{
+  std::vector<l2Shard *> & shards;
+  int blk_offs;
+  size_t set_mask;
+
+public :
+  l2FanOut(std::vector<l2Shard *> & s, const replayConfig & cfg) : shards(s)
+  {
+    size_t num_sets = ((size_t) cfg.l2s * 1024 / cfg.l2b) / cfg.l2w;
+    set_mask = num_sets - 1;
+    blk_offs = 0;
+    while ((1 << blk_offs) < cfg.l2b)
+      blk_offs++;
+  }
+
+  void access(size_t addr, size_t pc, bool wr_access)
+  {
+    size_t set_idx = (addr >> blk_offs) & set_mask;
+    L2Req req = { addr, pc, wr_access, false, false };
+    shards[set_idx % shards.size()]->queue.push(req);
+  }
+
+  void writeback(size_t blk_addr, size_t pc)
+  {
+    size_t set_idx = (blk_addr >> blk_offs) & set_mask;
+    L2Req req = { blk_addr, pc, true, true, false };
+    shards[set_idx % shards.size()]->queue.push(req);
+  }
+};
+
+static void print_stats(std::ostream & out, const std::string & name, cacheSim * c)
+{
+  out << name << " ACCESS COUNT: " << c->get_access_cnt() << std::endl;
+  out << name << " MISS COUNT: " << c->get_miss_cnt() << std::endl;
+  out << name << " DEAD BLK PRED: " << c->get_dbp_cnt() << std::endl;
+  out << name << " EVICTIONS: " << c->get_evicted_cnt() << std::endl;
+  out << name << " DBP MISS_PRED: " << c->get_dbp_miss_pred() << std::endl;
+  out << name << " TCP Prefetches: " << c->get_tcp_pr_cnt() << std::endl;
+  out << name << " TCP Useless Prefetches: " << c->get_useless_pr_cnt() << std::endl;
+  out << name << " BYPASSED FILLS: " << c->get_bypass_cnt() << std::endl;
+  out << name << " WRITE-BACKS RECEIVED: " << c->get_wb_cnt() << std::endl;
+  out << name << " WRITE-BACK FILLS: " << c->get_wb_fill_cnt() << std::endl;
+  if (c->wbb)
+    c->wbb->report(out, name);
+  if (c->vc)
+    c->vc->report(out, name);
+  for (size_t i = 0; i < c->get_prefetchers().size(); i++)
+    c->get_prefetchers()[i]->report(out, name, c->get_miss_cnt());
+#ifdef BLK_LIFETIME_STATS
+  c->report_lifetimes(out, name);
+#endif
+}
+
+static int usage()
+{
+  std::cerr << "usage: cacheReplay -t <trace.gz> [-l1s KB] [-l1b B] [-l1w W] [-l2s KB] [-l2b B] [-l2w W]"
+               " [-p 0|1] [-threads N] [-repl lru|srrip|drrip|ship|dbp|all]"
+               " [-pfl1 engines] [-pfl2 engines] [-pfdelay N] [-timing 0|1] [-memlat cycles] [-hier file]"
+               " [-sample period:unit:warm] [-smpfw 0|1] [-tlb 0|1] [-thp 0|1] [-wbb N] [-vc N] [-wbtrain 0|1]" << std::endl;
+  return -1;
+}
+
+//TLBs with the default dbpSim geometry; walks go to l2
+static mmuSim * new_mmu(const replayConfig & cfg, cacheSim * l2)
+{
+  if (!cfg.tlb)
+    return 0;
+  mmuSim * mmu = new mmuSim(128, 8, 64, 4, 1536, 12, 32, 4096, cfg.thp != 0);
+  mmu->walk_cache = l2;
+  return mmu;
+}
+
+//feed all trace records to the L1s (translated first if mmu is set); returns the number of records
+static long replay_records(traceReader & reader, cacheSim * l1i, cacheSim * l1d, timingModel * timing,
+                           smartsSampler * sampler, mmuSim * mmu)
+{
+  TraceRec rec;
+  long rec_cnt = 0;
+  long phase_left = sampler ? sampler->get_phase_len() : 0;
+  while (reader.next(rec))
+  {
+    rec_cnt++;
+    if (sampler)
+    {
+      if (rec.type == TR_IFETCH && --phase_left < 0)
+        phase_left = sampler->next_phase() - 1;
+      if (!sampler->detailed())
+      {
+        if (sampler->functional_warming)
+          (rec.type == TR_IFETCH ? l1i : l1d)->warm(rec.addr, rec.pc, rec.type == TR_WRITE);
+        continue;
+      }
+    }
+    if (mmu)
+    {
+      rec.addr = mmu->translate(rec.addr, rec.pc, rec.type == TR_IFETCH);
+      if (timing)
+        timing->stall(mmu->walk_latency);
+    }
+    if (rec.type == TR_IFETCH)
+    {
+      if (timing)
+        timing->tick_instr();
+      l1i->access(rec.addr, rec.pc, false);
+      if (timing)
+        timing->stall(l1i->last_latency - l1i->tm.hit_latency);
+    }
+    else
+    {
+      l1d->access(rec.addr, rec.pc, rec.type == TR_WRITE);
+      if (timing && rec.type == TR_READ)
+        timing->stall(l1d->last_latency - l1d->tm.hit_latency);
+    }
+  }
+  if (sampler)
+    sampler->finish(phase_left);
+  return rec_cnt;
+}
+
+//replay one trace through a fresh hierarchy; returns false if the trace cannot be read
+static bool replay(const replayConfig & cfg, const std::string & trace_file, replKind repl, replayResult & res)
+{
+  gz::igzstream trace_in(trace_file.c_str());
+  traceReader reader;
+  if (!trace_in.good() || !reader.open(&trace_in))
+  {
+    std::cerr << "cacheReplay: cannot read trace " << trace_file << std::endl;
+    return false;
+  }
+
+  //L2 is either one sequential cache, or N set-partitioned shards
+  cacheSim * L2_CACHE = new cacheSim(cfg.l2s, cfg.l2b, cfg.l2w, 0);
+  L2_CACHE->dbp_use_refcount = true;
+  cacheSim * L1_I_CACHE = new cacheSim(cfg.l1s, cfg.l1b, cfg.l1w, L2_CACHE);
+  cacheSim * L1_D_CACHE = new cacheSim(cfg.l1s, cfg.l1b, cfg.l1w, L2_CACHE);
+  L2_CACHE->repl = repl;
+  L1_I_CACHE->repl = repl;
+  L1_D_CACHE->repl = repl;
+
+  std::vector<prefetcher *> l1_engines, l2_engines;
+  parse_prefetchers(cfg.pf_l1, l1_engines);
+  parse_prefetchers(cfg.pf_l2, l2_engines);
+  for (size_t i = 0; i < l1_engines.size(); i++)
+    L1_D_CACHE->add_prefetcher(l1_engines[i]);
+  for (size_t i = 0; i < l2_engines.size(); i++)
+    L2_CACHE->add_prefetcher(l2_engines[i]);
+  L1_D_CACHE->pf_fill_delay = cfg.pf_delay;
+  L2_CACHE->pf_fill_delay = cfg.pf_delay;
+
+  if (cfg.wbb)
+  {
+    L1_D_CACHE->wbb = new wbBuffer(cfg.wbb);
+    L2_CACHE->wbb = new wbBuffer(cfg.wbb);
+  }
+  if (cfg.vc)
+    L1_D_CACHE->vc = new victimCache(cfg.vc);
+  L2_CACHE->wb_train = (cfg.wb_train != 0);
+
+  timingModel * timing = 0;
+  if (cfg.timing)
+  {
+    timing = new timingModel(cfg.mem_lat);
+    L1_I_CACHE->timing = L1_D_CACHE->timing = L2_CACHE->timing = timing;
+    L1_I_CACHE->tm.hit_latency = L1_D_CACHE->tm.hit_latency = 4;
+    L2_CACHE->tm.hit_latency = 12;
+    L2_CACHE->tm.mshrs = 16;
+  }
+
+  smartsSampler * sampler = 0;
+  if (cfg.smp_period)
+  {
+    sampler = new smartsSampler(cfg.smp_period, cfg.smp_unit, cfg.smp_warm);
+    sampler->functional_warming = (cfg.smp_fw != 0);
+    sampler->add_cache("L1 I_CACHE", L1_I_CACHE);
+    sampler->add_cache("L1 D_CACHE", L1_D_CACHE);
+    sampler->add_cache("L2 CACHE", L2_CACHE);
+  }
+
+  std::vector<l2Shard *> shards;
+  l2FanOut * fan_out = 0;
+  if (cfg.threads > 1)
+  {
+    for (int i = 0; i < cfg.threads; i++)
+      shards.push_back(new l2Shard(cfg, repl));
+    for (int i = 0; i < cfg.threads; i++)
+      shards[i]->worker = std::thread(&l2Shard::run, shards[i]);
+    fan_out = new l2FanOut(shards, cfg);
+    L1_I_CACHE->miss_sink = fan_out;
+    L1_D_CACHE->miss_sink = fan_out;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  mmuSim * mmu = new_mmu(cfg, L2_CACHE);
+  long rec_cnt = replay_records(reader, L1_I_CACHE, L1_D_CACHE, timing, sampler, mmu);
+
+  //write-backs still queued in the buffers reach the next level before reporting
+  L1_D_CACHE->drain_write_backs();
+  L2_CACHE->drain_write_backs();
+
+  //drain the shards and merge their L2 counters
+  if (cfg.threads > 1)
+  {
+    L2Req done = { 0, 0, false, false, true };
+    for (size_t i = 0; i < shards.size(); i++)
+      shards[i]->queue.push(done);
+    for (size_t i = 0; i < shards.size(); i++)
+    {
+      shards[i]->worker.join();
+      L2_CACHE->merge_stats(*shards[i]->l2);
+      delete shards[i];
+    }
+    delete fan_out;
+  }
+
+  res.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  res.rec_cnt = rec_cnt;
+  res.l1i = L1_I_CACHE;
+  res.l1d = L1_D_CACHE;
+  res.l2 = L2_CACHE;
+  res.timing = timing;
+  res.sampler = sampler;
+  res.mmu = mmu;
+  return true;
+}
+
+//replay one trace through a hierarchy file
+static bool replay_hierarchy(const replayConfig & cfg, const std::string & trace_file)
+{
+  gz::igzstream trace_in(trace_file.c_str());
+  traceReader reader;
+  if (!trace_in.good() || !reader.open(&trace_in))
+  {
+    std::cerr << "cacheReplay: cannot read trace " << trace_file << std::endl;
+    return false;
+  }
+
+  cacheHierarchy hier;
+  std::string err;
+  if (!hier.load(cfg.hier, err))
+  {
+    std::cerr << "cacheReplay: " << cfg.hier << ": " << err << std::endl;
+    return false;
+  }
+  timingModel * timing = cfg.timing ? hier.enable_timing() : 0;
+  for (size_t i = 0; i < hier.num_levels(); i++)
+    hier.level(i)->wb_train = (cfg.wb_train != 0);
+
+  mmuSim * mmu = new_mmu(cfg, hier.dcache->get_parent());
+  long rec_cnt = replay_records(reader, hier.icache, hier.dcache, timing, 0, mmu);
+  hier.drain_write_backs();
+
+  std::cout << "\ncacheReplay: Cache Statistics : " << std::endl;
+  std::cout << "==============================================" << std::endl;
+  std::cout << "Trace: " << trace_file << " (" << rec_cnt << " records)" << std::endl;
+  std::cout << "Hierarchy: " << cfg.hier << std::endl;
+  hier.report(std::cout);
+  if (mmu)
+  {
+    std::cout << std::endl;
+    mmu->report(std::cout, hier.icache->get_access_cnt());
+    delete mmu;
+  }
+  std::cout << "==============================================" << std::endl;
+  return true;
+}
+
+static double miss_reduction(cacheSim * base, cacheSim * c)
+{
+  if (base->get_miss_cnt() == 0)
+    return 0.0;
+  return 100.0 * (double)(base->get_miss_cnt() - c->get_miss_cnt()) / (double) base->get_miss_cnt();
+}
+
+//replay a trace with every policy and report misses and reduction against LRU per level
+static bool compare_policies(const replayConfig & cfg, const std::string & trace_file)
+{
+  replayResult res[NUM_REPL];
+  for (int k = 0; k < NUM_REPL; k++)
+  {
+    if (!replay(cfg, trace_file, (replKind) k, res[k]))
+      return false;
+  }
+
+  std::cout << "\nTrace: " << trace_file << " (" << res[REPL_LRU].rec_cnt << " records)" << std::endl;
+  char line[256];
+  snprintf(line, sizeof(line), "%-8s %14s %8s %14s %8s %14s %8s",
+           "POLICY", "L1I MISSES", "RED(%)", "L1D MISSES", "RED(%)", "L2 MISSES", "RED(%)");
+  std::cout << line << std::endl;
+  for (int k = 0; k < NUM_REPL; k++)
+  {
+    snprintf(line, sizeof(line), "%-8s %14ld %8.2f %14ld %8.2f %14ld %8.2f", repl_name((replKind) k),
+             res[k].l1i->get_miss_cnt(), miss_reduction(res[REPL_LRU].l1i, res[k].l1i),
+             res[k].l1d->get_miss_cnt(), miss_reduction(res[REPL_LRU].l1d, res[k].l1d),
+             res[k].l2->get_miss_cnt(), miss_reduction(res[REPL_LRU].l2, res[k].l2));
+    std::cout << line << std::endl;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  replayConfig cfg;
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 >= argc)
+      return usage();
+    std::string opt(argv[i]);
+    const char * val = argv[++i];
+    if (opt == "-t") cfg.trace_files.push_back(val);
+    else if (opt == "-l1s") cfg.l1s = atoi(val);
+    else if (opt == "-l1b") cfg.l1b = atoi(val);
+    else if (opt == "-l1w") cfg.l1w = atoi(val);
+    else if (opt == "-l2s") cfg.l2s = atoi(val);
+    else if (opt == "-l2b") cfg.l2b = atoi(val);
+    else if (opt == "-l2w") cfg.l2w = atoi(val);
+    else if (opt == "-p") cfg.tcp = atoi(val);
+    else if (opt == "-threads") cfg.threads = atoi(val);
+    else if (opt == "-repl") cfg.repl = val;
+    else if (opt == "-pfl1") cfg.pf_l1 = val;
+    else if (opt == "-pfl2") cfg.pf_l2 = val;
+    else if (opt == "-pfdelay") cfg.pf_delay = atoi(val);
+    else if (opt == "-timing") cfg.timing = atoi(val);
+    else if (opt == "-memlat") cfg.mem_lat = atoi(val);
+    else if (opt == "-hier") cfg.hier = val;
+    else if (opt == "-sample")
+    {
+      if (sscanf(val, "%ld:%ld:%ld", &cfg.smp_period, &cfg.smp_unit, &cfg.smp_warm) != 3)
+        return usage();
+    }
+    else if (opt == "-smpfw") cfg.smp_fw = atoi(val);
+    else if (opt == "-tlb") cfg.tlb = atoi(val);
+    else if (opt == "-thp") cfg.thp = atoi(val);
+    else if (opt == "-wbb") cfg.wbb = atoi(val);
+    else if (opt == "-vc") cfg.vc = atoi(val);
+    else if (opt == "-wbtrain") cfg.wb_train = atoi(val);
+    else return usage();
+  }
+  if (cfg.trace_files.empty() || cfg.threads < 1)
+    return usage();
+  if (cfg.repl != "all" && parse_repl(cfg.repl) == NUM_REPL)
+    return usage();
+
+  //validate the engine lists once; replay() builds fresh engines per run
+  std::vector<prefetcher *> check;
+  if (!parse_prefetchers(cfg.pf_l1, check) || !parse_prefetchers(cfg.pf_l2, check))
+    return usage();
+  for (size_t i = 0; i < check.size(); i++)
+    delete check[i];
+  if ((!cfg.pf_l2.empty() || cfg.timing) && cfg.threads > 1)
+  {
+    std::cerr << "cacheReplay: -pfl2 and -timing cannot be combined with -threads" << std::endl;
+    return -1;
+  }
+
+  //the shards would each train a private copy of the policy state
+  if (cfg.threads > 1 && (cfg.repl == "all" || repl_shares_state(parse_repl(cfg.repl))))
+  {
+    std::cerr << "cacheReplay: -repl drrip, ship, dbp and all cannot be combined with -threads" << std::endl;
+    return -1;
+  }
+
+  //one L2 write-back buffer spans all sets; the shards have none
+  if (cfg.wbb && cfg.threads > 1)
+  {
+    std::cerr << "cacheReplay: -wbb cannot be combined with -threads" << std::endl;
+    return -1;
+  }
+
+  if (cfg.tlb && (cfg.threads > 1 || cfg.smp_period))
+  {
+    std::cerr << "cacheReplay: -tlb cannot be combined with -threads or -sample" << std::endl;
+    return -1;
+  }
+
+  if (!cfg.hier.empty() && (cfg.threads > 1 || cfg.repl == "all"))
+  {
+    std::cerr << "cacheReplay: -hier cannot be combined with -threads or -repl all" << std::endl;
+    return -1;
+  }
+
+  if (cfg.smp_period)
+  {
+    smartsSampler check_smp(cfg.smp_period, cfg.smp_unit, cfg.smp_warm);
+    if (!check_smp.valid())
+    {
+      std::cerr << "cacheReplay: -sample needs unit > 0 and unit + warm <= period" << std::endl;
+      return -1;
+    }
+    if (cfg.threads > 1 || cfg.timing || !cfg.hier.empty())
+    {
+      std::cerr << "cacheReplay: -sample cannot be combined with -threads, -timing or -hier" << std::endl;
+      return -1;
+    }
+  }
+
+  TcpEnabled = (cfg.tcp != 0);
+
+  for (size_t t = 0; t < cfg.trace_files.size(); t++)
+  {
+    const std::string & trace_file = cfg.trace_files[t];
+    if (!cfg.hier.empty())
+    {
+      if (!replay_hierarchy(cfg, trace_file))
+        return -1;
+      continue;
+    }
+    if (cfg.repl == "all")
+    {
+      if (!compare_policies(cfg, trace_file))
+        return -1;
+      continue;
+    }
+
+    replayResult res;
+    if (!replay(cfg, trace_file, parse_repl(cfg.repl), res))
+      return -1;
+
+    std::cout << "\ncacheReplay: Cache Statistics : " << std::endl;
+    std::cout << "==============================================" << std::endl;
+    std::cout << "Trace: " << trace_file << " (" << res.rec_cnt << " records)" << std::endl;
+    std::cout << "L2 Threads: " << cfg.threads << std::endl;
+    std::cout << "Replacement Policy: " << cfg.repl << std::endl;
+    print_stats(std::cout, "L1 I_CACHE", res.l1i);
+    print_stats(std::cout, "L1 D_CACHE", res.l1d);
+    print_stats(std::cout, "L2 CACHE", res.l2);
+    if (res.timing)
+    {
+      res.timing->report(std::cout);
+      res.l1i->tm.report(std::cout, "L1 I_CACHE", res.l1i->get_access_cnt());
+      res.l1d->tm.report(std::cout, "L1 D_CACHE", res.l1d->get_access_cnt());
+      res.l2->tm.report(std::cout, "L2 CACHE", res.l2->get_access_cnt());
+    }
+    if (res.mmu)
+    {
+      std::cout << std::endl;
+      res.mmu->report(std::cout, res.l1i->get_access_cnt());
+    }
+    if (res.sampler)
+    {
+      std::cout << "\nSampled Estimates (counters above cover the detailed phases only): " << std::endl;
+      res.sampler->report(std::cout, 95);
+    }
+    std::cout << "==============================================" << std::endl;
+    std::cerr << "cacheReplay: " << res.secs << " s, " << (res.rec_cnt / (res.secs > 0 ? res.secs : 1)) << " records/s" << std::endl;
+  }
+  return 0;
+}
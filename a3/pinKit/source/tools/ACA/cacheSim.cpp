@@ -1,4 +1,7 @@
 #include "cacheSim.h"
+#include "stackDist.h"
+#include "wbBuffer.h"
+#include <algorithm>
 
 static inline bool IS_POW_2(int num)
 {
@@ -19,7 +22,10 @@ static inline int LOGB2C(int num)
 
 cacheSim::cacheSim(int t_sz_kb, int b_sz_b, int ways, cacheSim* parent)
  : rd_cnt(0), wr_cnt(0), cache_miss(0), dbp_cnt(0), dbp_miss_pred(0), evicted_cnt(0), tcp_pr_cnt(0),  
-   useless_pr_cnt(0), parent_cache(parent), dbp_use_refcount(false)
+   useless_pr_cnt(0), bypass_cnt(0), back_inval_cnt(0), wb_cnt(0), wb_fill_cnt(0), parent_cache(parent), dbp_use_refcount(false),
+   dbp_enable(true), inclusion(INCL_NINE), mrc(0),
+   dbp_tbl(&dbp_tables), miss_sink(0), evict_listener(0), wbb(0), vc(0), wb_train(true), repl(REPL_LRU), pf_fill_delay(PF_FILL_DELAY),
+   timing(0), last_latency(0)
 {
   assert(IS_POW_2(b_sz_b));
   total_size_kb = t_sz_kb;
@@ -33,12 +39,119 @@ cacheSim::cacheSim(int t_sz_kb, int b_sz_b, int ways, cacheSim* parent)
   set_bits = LOGB2C(num_sets);
   sets.resize(num_sets, std::list<Entry>());
   miss_hist.resize(num_sets, TagSR());
+#ifdef BLK_LIFETIME_STATS
+  lt = lifetimeStats();
+#endif
+}
+
+cacheSim::~cacheSim()
+{
+  for (size_t i = 0; i < prefetchers.size(); i++)
+    delete prefetchers[i];
+  delete wbb;
+  delete vc;
+}
+
+void cacheSim::add_prefetcher(prefetcher * pf)
+{
+  //pf_src is an unsigned char
+  assert(prefetchers.size() < 255);
+  pf->set_block_offset(blk_offs);
+  prefetchers.push_back(pf);
+}
+
+//simulates a single cache access; dispatches once to the selected replacement policy
+void cacheSim::access(size_t addr, size_t pc, bool wr_access, bool is_wb)
+{
+  if (is_wb)
+    wb_cnt++;
+  if (inclusion == INCL_EXCLUSIVE)
+  {
+    access_exclusive(addr, pc, wr_access);
+    return;
+  }
+  switch (repl)
+  {
+    case REPL_SRRIP: access_impl<srripPolicy>(addr, pc, wr_access, is_wb); break;
+    case REPL_DRRIP: access_impl<drripPolicy>(addr, pc, wr_access, is_wb); break;
+    case REPL_SHIP:  access_impl<shipPolicy>(addr, pc, wr_access, is_wb); break;
+    case REPL_DBP:   access_impl<dbpPolicy>(addr, pc, wr_access, is_wb); break;
+    default:         access_impl<lruPolicy>(addr, pc, wr_access, is_wb); break;
+  }
+}
+
+void cacheSim::warm(size_t addr, size_t pc, bool wr_access)
+{
+  switch (repl)
+  {
+    case REPL_SRRIP: warm_impl<srripPolicy>(addr, pc, wr_access); break;
+    case REPL_DRRIP: warm_impl<drripPolicy>(addr, pc, wr_access); break;
+    case REPL_SHIP:  warm_impl<shipPolicy>(addr, pc, wr_access); break;
+    case REPL_DBP:   warm_impl<dbpPolicy>(addr, pc, wr_access); break;
+    default:         warm_impl<lruPolicy>(addr, pc, wr_access); break;
+  }
+}
+
+//same set/recency update as access_impl, without predictors and statistics
+template <class Policy>
+void cacheSim::warm_impl(size_t addr, size_t pc, bool wr_access)
+{
+  size_t set_idx = (addr >> blk_offs) & ((1 << set_bits) - 1);
+  size_t tag_bits = addr >> (blk_offs + set_bits);
+  std::list<Entry> & set = sets[set_idx];
+
+  for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->tag == tag_bits)
+    {
+      it->dirty |= wr_access;
+      it->refCount += 1;
+      Policy::on_hit(repl_state, *it, set_idx);
+      set.splice(set.end(), set, it);
+      return;
+    }
+  }
+
+  Entry n_blk;
+  n_blk.tag = tag_bits;
+  n_blk.dirty = wr_access;
+  n_blk.pred_dead = false;
+  n_blk.prefetched = false;
+  n_blk.referenced = false;
+  n_blk.refCount = 0;
+  n_blk.rrpv = 0;
+  n_blk.ship_sig = 0;
+  n_blk.pf_src = 0;
+  n_blk.ready = 0;
+  lt_fill(n_blk);
+  Policy::on_insert(repl_state, n_blk, set_idx, pc, false);
+
+  //BurstTrace keeps a history entry for every resident blk; start an empty burst
+  size_t m_blk_addr = (tag_bits << (blk_offs + set_bits)) | (set_idx << blk_offs);
+  if (dbp_enable && !dbp_use_refcount)
+    insert_on_miss_trace(*dbp_tbl, m_blk_addr, pc);
+
+  if ((int)set.size() >= set_ways)
+  {
+    std::list<Entry>::iterator victim = Policy::choose_victim(repl_state, set, set_idx);
+    bool is_dirty = victim->dirty;
+    size_t evicted_addr = (victim->tag << (blk_offs + set_bits)) | (set_idx << blk_offs);
+    set.erase(victim);
+    if (is_dirty && parent_cache)
+      parent_cache->warm(evicted_addr, pc, true);
+  }
+  set.push_back(n_blk);
 
+  if (parent_cache)
+    parent_cache->warm(addr, pc, wr_access);
 }
 
-//simulates a single cache access   
-void cacheSim::access(size_t addr, size_t pc, bool wr_access)
+template <class Policy>
+void cacheSim::access_impl(size_t addr, size_t pc, bool wr_access, bool is_wb)
 {
+  //write-backs train the predictors only if wb_train is set
+  bool train = !is_wb || wb_train;
+
   if (wr_access)
   {
     wr_cnt++;
@@ -48,6 +161,17 @@ void cacheSim::access(size_t addr, size_t pc, bool wr_access)
     rd_cnt++;
   }
 
+  if (mrc)
+    mrc->access(addr);
+
+  //fill the engine prefetches that became ready
+  while (!pf_queue.empty() && pf_queue.front().ready <= get_access_cnt())
+  {
+    PfReq req = pf_queue.front();
+    pf_queue.pop_front();
+    fill_prefetch<Policy>(req);
+  }
+
   size_t set_idx = (addr >> blk_offs) & ((1 << set_bits) - 1);
   size_t tag_bits = addr >> (blk_offs + set_bits);
 
@@ -65,32 +189,55 @@ void cacheSim::access(size_t addr, size_t pc, bool wr_access)
     assert(false);
   } 
 
+  dbpTables & tbl = *dbp_tbl;
+
   //select a cache set
   std::list<Entry> & set = sets.at(set_idx);
+  int pf_hit_src = 0;
   assert(set.size() <= (unsigned) set_ways); 
 
   //tag and trace of MRU cache block before the cache set is updated
-  size_t mru_tag;
+  size_t mru_tag = 0;
   if (set.size() > 0) {
     mru_tag = set.back().tag;
   }
-  Entry hit_blk;
   for(std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
   {
      if (it->tag == tag_bits)
      {
        cache_hit = true;
+       it->dirty |= wr_access;
+       if (!train)
+       {
+         //recency order only: not a reference of the blk for DBP, TCP, the engines or
+         //the replacement policy
+         set.splice(set.end(), set, it);
+         break;
+       }
        it->referenced = true;
-       it->dirty = wr_access;
        size_t blk_addr = (tag_bits << (blk_offs + set_bits)) | (set_idx << blk_offs);
  
        //trace update
-       if (!dbp_use_refcount && (tag_bits != set.back().tag)) 
+       if (dbp_enable && !dbp_use_refcount && (tag_bits != set.back().tag)) 
        {
-         update_trace(blk_addr, pc);
+         update_trace(tbl, blk_addr, pc);
        }
        it->refCount += 1;
 
+       //first demand hit on an engine prefetch
+       if (it->pf_src)
+       {
+         //with timing, a prefetch that has not arrived yet is late
+         if (timing && it->ready > timing->cycle)
+           prefetchers[it->pf_src - 1]->late++;
+         else
+           prefetchers[it->pf_src - 1]->useful++;
+         pf_hit_src = it->pf_src;
+         it->pf_src = 0;
+       }
+
+       lt_hit(*it);
+
        //update trace & refCount on a start of BURST
        //see if DBP miss-predicted a blk: the blk is predicted dead, but referenced again!
        if (it->pred_dead) {
@@ -105,27 +252,44 @@ void cacheSim::access(size_t addr, size_t pc, bool wr_access)
        //       dbp_cnt++;
        //     }
        //}
-       else if (dbp_use_refcount)
+       else if (dbp_enable && dbp_use_refcount)
        {
-         if(predict_db_cnt(blk_addr, it->refCount))
+         if(predict_db_cnt(tbl, blk_addr, it->refCount))
          {
            it->pred_dead = true;
            dbp_cnt++;
          }
        }
 
+       Policy::on_hit(repl_state, *it, set_idx);
+
+       //a hit on a blk still being filled waits for the rest of the fill
+       if (timing)
+       {
+         long now = timing->cycle;
+         long lat = tm.hit_latency;
+         if (it->ready > now)
+         {
+           lat = std::max(lat, it->ready - now);
+           if (it->prefetched && it->refCount == 1)
+             tm.pf_partial_hits++;
+           else
+             tm.mshr_merges++;
+         }
+         last_latency = lat;
+         tm.total_latency += lat;
+       }
+
        //LRU position update for the hit block
-       hit_blk = *it; 
-       set.erase(it);
-       set.push_back(hit_blk);
+       set.splice(set.end(), set, it);
        break;
      }
   } 
   //BurstTrace: predict dead block at the end of cache burst
-  if(!dbp_use_refcount && cache_hit && mru_tag != set.back().tag)
+  if(dbp_enable && !dbp_use_refcount && cache_hit && train && mru_tag != set.back().tag)
   {
     size_t blk_addr = (mru_tag << (blk_offs + set_bits)) | (set_idx << blk_offs);
-    if(predict_db_trace(blk_addr))
+    if(predict_db_trace(tbl, blk_addr))
     {
       //second-last element == last MRU block
       auto it = ++(set.rbegin());
@@ -138,73 +302,168 @@ void cacheSim::access(size_t addr, size_t pc, bool wr_access)
   //access next level cache hiearchy
   if(!cache_hit)
   {
-    cache_miss++;
+    //an untrained write-back fill is not a demand miss and casts no set-dueling vote
+    if (train)
+    {
+      cache_miss++;
+      Policy::on_miss(repl_state, set_idx);
+    }
+    else
+      wb_fill_cnt++;
     //start TRACE for missed block
     size_t m_blk_addr = (tag_bits << (blk_offs + set_bits)) | (set_idx << blk_offs);
 
-    if (dbp_use_refcount)
-      insert_on_miss_cnt(m_blk_addr);
-    else
-      insert_on_miss_trace(m_blk_addr, pc);
+    //the demand fetch supersedes a prefetch of the blk that is still in flight
+    for (std::deque<PfReq>::iterator q = pf_queue.begin(); q != pf_queue.end(); q++)
+    {
+      if (q->blk_addr == m_blk_addr)
+      {
+        if (train)
+          prefetchers[q->src - 1]->late++;
+        pf_queue.erase(q);
+        break;
+      }
+    }
+
+    if (dbp_enable && train && dbp_use_refcount)
+      insert_on_miss_cnt(tbl, m_blk_addr);
+    else if (dbp_enable && train)
+      insert_on_miss_trace(tbl, m_blk_addr, pc);
 
     //1) update TCP correlation table
     TagSR tag_sr = miss_hist.at(set_idx); 
-    update_tc_tbl(tag_sr, tag_bits, blk_offs, set_bits, dbp_use_refcount);
+    if (dbp_enable && train)
+      update_tc_tbl(tbl, tag_sr, tag_bits, blk_offs, set_bits, dbp_use_refcount);
 
     //2) update miss_hist TAG_SR
-    tag_sr.tag_0 = tag_sr.tag_1;
-    tag_sr.valid_0 = tag_sr.valid_1;
-    //tag_sr.tag_1 = tag_bits;
-    tag_sr.tag_1 = m_blk_addr;
-    tag_sr.valid_1 = true;
-    miss_hist[set_idx] = tag_sr;
+    if (train)
+    {
+      tag_sr.tag_0 = tag_sr.tag_1;
+      tag_sr.valid_0 = tag_sr.valid_1;
+      //tag_sr.tag_1 = tag_bits;
+      tag_sr.tag_1 = m_blk_addr;
+      tag_sr.valid_1 = true;
+      miss_hist[set_idx] = tag_sr;
+    }
+
+    //the blk may still be in the victim cache or the write-back buffer
+    bool local_fill = false;
+    bool local_dirty = false;
+    if (vc && vc->take(m_blk_addr, local_dirty))
+      local_fill = true;
+    else if (wbb && wbb->take(m_blk_addr))
+      local_fill = local_dirty = true;
    
     //3) Fetch a missed block
     Entry n_blk; 
     n_blk.tag = tag_bits;
-    n_blk.dirty = wr_access;
+    n_blk.dirty = wr_access || local_dirty;
     n_blk.pred_dead = false;
     n_blk.prefetched = false;
     n_blk.referenced = false;
     //n_blk.burstTrace = pc & ((1 << 30) - 1);
     n_blk.refCount = 0;
-
-    if((int)set.size() < set_ways)
+    n_blk.rrpv = 0;
+    n_blk.ship_sig = 0;
+    n_blk.pf_src = 0;
+    n_blk.ready = 0;
+    lt_fill(n_blk);
+    bool allocated = false;
+
+    //dead-on-arrival prediction, only computed for DBP-aware policies
+    bool dead_on_arrival = false;
+    if (Policy::uses_dbp && dbp_enable && train)
+      dead_on_arrival = dbp_use_refcount ? predict_db_cnt(tbl, m_blk_addr, 0) : predict_db_trace(tbl, m_blk_addr);
+
+    if (Policy::bypass(repl_state, set_idx, dead_on_arrival))
+    {
+      bypass_cnt++;
+    }
+    else if((int)set.size() < set_ways)
     {
+      if (train)
+        Policy::on_insert(repl_state, n_blk, set_idx, pc, dead_on_arrival);
+      else
+        Policy::on_wb_insert(repl_state, n_blk);
+      if (dead_on_arrival)
+      {
+        n_blk.pred_dead = true;
+        dbp_cnt++;
+      }
       set.push_back(n_blk);
+      allocated = true;
     } 
     else
     {
-      //eviction required
-      bool is_dirty = set.front().dirty;
-      size_t evicted_addr = (set.front().tag << (blk_offs + set_bits)) | (set_idx << blk_offs);
-      size_t ref_cnt = set.front().refCount;
-
-      evicted_cnt++;
-
-      //if evicted block is prefetched && never referenced
-      if(set.front().referenced == false && set.front().prefetched)
-         useless_pr_cnt++;
-
-      set.pop_front();
-      set.push_back(n_blk);
-
-      //on eviction, update old_trace
-      if(dbp_use_refcount)
-        update_on_eviction_cnt(evicted_addr, ref_cnt);
+      if (train)
+        Policy::on_insert(repl_state, n_blk, set_idx, pc, dead_on_arrival);
       else
-        update_on_eviction_trace(evicted_addr);
+        Policy::on_wb_insert(repl_state, n_blk);
+      if (dead_on_arrival)
+      {
+        n_blk.pred_dead = true;
+        dbp_cnt++;
+      }
 
-      if(is_dirty && parent_cache) 
-        parent_cache->access(evicted_addr, pc, true);
+      //eviction required
+      evict_block<Policy>(set, Policy::choose_victim(repl_state, set, set_idx), set_idx, pc);
+      set.push_back(n_blk);
+      allocated = true;
     }
 
-    if (parent_cache) 
-      parent_cache->access(addr, pc, wr_access);
+    if (local_fill)
+    {
+      //a bypassed fill leaves its dirty data to the next level
+      if (!allocated && local_dirty)
+        write_back(m_blk_addr, pc);
+    }
+    else if (miss_sink && is_wb)
+      miss_sink->writeback(addr, pc);
+    else if (miss_sink)
+      miss_sink->access(addr, pc, wr_access);
+    else if (parent_cache) 
+      parent_cache->access(addr, pc, wr_access, is_wb);
+
+    //miss latency: own lookup + MSHR wait + next level (or memory)
+    long fill_ready = 0;
+    if (timing && local_fill)
+    {
+      //one extra cycle to probe the victim cache / write-back buffer
+      last_latency = tm.hit_latency + 1;
+      tm.total_latency += last_latency;
+      if (allocated)
+        set.back().ready = timing->cycle + last_latency;
+    }
+    else if (timing)
+    {
+      long now = timing->cycle;
+      long lat = tm.hit_latency + tm.alloc_mshr(now) + (parent_cache ? parent_cache->last_latency : timing->mem_latency);
+      fill_ready = now + lat;
+      tm.fill_mshr(fill_ready);
+      if (allocated)
+        set.back().ready = fill_ready;
+      last_latency = lat;
+      tm.total_latency += lat;
+    }
 
     //4) Prefetch Operation
     bool prefetched = false;
-    size_t prefetch_tag = tcp_prefetch(tag_sr, blk_offs, set_bits, dbp_use_refcount, &prefetched);
+    size_t prefetch_tag = 0;
+    if (dbp_enable && train)
+      prefetch_tag = tcp_prefetch(tbl, tag_sr, blk_offs, set_bits, dbp_use_refcount, &prefetched);
+
+    //the prefetched blk may already be cached
+    if (prefetched)
+    {
+      for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+      {
+        if (it->tag == prefetch_tag)
+        {
+          prefetched = false;
+          break;
+        }
+      }
+    }
 
     //insert into dead-block position; if not LRU
     if (prefetched) 
@@ -213,21 +472,39 @@ void cacheSim::access(size_t addr, size_t pc, bool wr_access)
       {
         if (it->pred_dead)
         {
-         it->dirty = false;
-         it->pred_dead = false;
-         it->prefetched = true;
-         it->referenced = false;
-         it->tag = prefetch_tag;
-         it->refCount = 0;
+         Entry p_blk;
+         p_blk.tag = prefetch_tag;
+         p_blk.dirty = false;
+         p_blk.pred_dead = false;
+         p_blk.prefetched = true;
+         p_blk.referenced = false;
+         p_blk.refCount = 0;
+         p_blk.rrpv = 0;
+         p_blk.ship_sig = 0;
+         p_blk.pf_src = 0;
+         p_blk.ready = fill_ready; //timed like the miss that triggered it
+         lt_fill(p_blk);
+         Policy::on_insert(repl_state, p_blk, set_idx, pc, false);
          //use_LRU = false; 
          tcp_pr_cnt++;
+
+         //take the dead blk's position, then evict it like any victim
+         //(write-back, victim cache, inclusion and eviction listener)
+         set.insert(it, p_blk);
+         evict_block<Policy>(set, it, set_idx, pc);
         
          //DBP history update for the prefetched block
          size_t blk_addr = (prefetch_tag << (blk_offs + set_bits)) | (set_idx << blk_offs);
          if(dbp_use_refcount)
-           insert_on_miss_cnt(blk_addr);
+           insert_on_miss_cnt(tbl, blk_addr);
          else
-           insert_on_miss_trace(blk_addr, pc);
+           insert_on_miss_trace(tbl, blk_addr, pc);
+
+         //fetch it through the next level, which keeps an inclusive parent inclusive
+         if (miss_sink)
+           miss_sink->access(blk_addr, pc, false);
+         else if (parent_cache)
+           parent_cache->access(blk_addr, pc, false);
          break;
         }
       }
@@ -250,6 +527,326 @@ void cacheSim::access(size_t addr, size_t pc, bool wr_access)
       //}
     //}
   }
+
+  if (!prefetchers.empty() && train)
+    train_prefetchers(addr, pc, !cache_hit, pf_hit_src);
+}
+
+//remove a block from a full set: stats, predictor training and write-back
+template <class Policy>
+void cacheSim::evict_block(std::list<Entry> & set, std::list<Entry>::iterator victim, size_t set_idx, size_t pc)
+{
+  dbpTables & tbl = *dbp_tbl;
+  bool is_dirty = victim->dirty;
+  size_t evicted_addr = (victim->tag << (blk_offs + set_bits)) | (set_idx << blk_offs);
+  size_t ref_cnt = victim->refCount;
+
+  evicted_cnt++;
+
+  //if evicted block is prefetched && never referenced
+  if(victim->referenced == false && victim->prefetched)
+     useless_pr_cnt++;
+  if(victim->pf_src)
+     prefetchers[victim->pf_src - 1]->useless++;
+
+  lt_evict(*victim);
+  Policy::on_evict(repl_state, *victim);
+  set.erase(victim);
+  if (evict_listener)
+    evict_listener->evicted(evicted_addr);
+
+  //on eviction, update old_trace
+  if(dbp_enable && dbp_use_refcount)
+    update_on_eviction_cnt(tbl, evicted_addr, ref_cnt);
+  else if(dbp_enable)
+    update_on_eviction_trace(tbl, evicted_addr);
+
+  //inclusion: the blk leaves all children; their dirty data is written back from here
+  if(inclusion == INCL_INCLUSIVE)
+  {
+    for (size_t c = 0; c < children.size(); c++)
+      is_dirty |= children[c]->invalidate(evicted_addr);
+  }
+
+  if (vc)
+  {
+    size_t out_addr;
+    bool out_dirty;
+    if (vc->insert(evicted_addr, is_dirty, out_addr, out_dirty))
+      send_victim(out_addr, pc, out_dirty);
+  }
+  else
+    send_victim(evicted_addr, pc, is_dirty);
+}
+
+long cacheSim::drain_write_backs()
+{
+  long n = 0;
+  size_t blk_addr;
+  while (wbb && wbb->pop(blk_addr))
+  {
+    n++;
+    if (miss_sink)
+      miss_sink->writeback(blk_addr, 0);
+    else if (parent_cache)
+      parent_cache->access(blk_addr, 0, true, true);
+  }
+  return n;
+}
+
+//a dirty blk leaves this cache: through the write-back buffer (if any) to the next level
+void cacheSim::write_back(size_t blk_addr, size_t pc)
+{
+  if (wbb)
+  {
+    size_t drained_addr;
+    if (!wbb->insert(blk_addr, drained_addr))
+      return;
+    blk_addr = drained_addr;
+  }
+  if (miss_sink)
+    miss_sink->writeback(blk_addr, pc);
+  else if (parent_cache)
+    parent_cache->access(blk_addr, pc, true, true);
+}
+
+//a blk leaving this cache (and its victim cache): victim fill of an exclusive parent, or write-back
+void cacheSim::send_victim(size_t blk_addr, size_t pc, bool dirty)
+{
+  if (!miss_sink && parent_cache && parent_cache->inclusion == INCL_EXCLUSIVE)
+    parent_cache->insert_victim(blk_addr, pc, dirty);
+  else if (dirty)
+    write_back(blk_addr, pc);
+}
+
+//EXCLUSIVE cache lookup: a hit hands the blk to the requesting child and drops it here,
+//a miss is forwarded without allocating (the blk only arrives as a child's victim).
+//Dirty data of a blk moving up is written back to the next level, so it is not lost
+//when the child later evicts a clean copy.
+void cacheSim::access_exclusive(size_t addr, size_t pc, bool wr_access)
+{
+  if (wr_access)
+    wr_cnt++;
+  else
+    rd_cnt++;
+
+  if (mrc)
+    mrc->access(addr);
+
+  size_t set_idx = (addr >> blk_offs) & ((1 << set_bits) - 1);
+  size_t tag_bits = addr >> (blk_offs + set_bits);
+  std::list<Entry> & set = sets[set_idx];
+
+  bool cache_hit = false;
+  for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->tag == tag_bits)
+    {
+      cache_hit = true;
+      bool was_dirty = it->dirty;
+      set.erase(it);
+      if (was_dirty)
+        write_back(addr & ~((size_t) block_size_b - 1), pc);
+      break;
+    }
+  }
+
+  if (!cache_hit)
+  {
+    cache_miss++;
+    if (parent_cache)
+      parent_cache->access(addr, pc, wr_access);
+  }
+
+  if (timing)
+  {
+    long lat = tm.hit_latency;
+    if (!cache_hit)
+    {
+      long now = timing->cycle;
+      lat += tm.alloc_mshr(now) + (parent_cache ? parent_cache->last_latency : timing->mem_latency);
+      tm.fill_mshr(now + lat);
+    }
+    last_latency = lat;
+    tm.total_latency += lat;
+  }
+}
+
+void cacheSim::insert_victim(size_t addr, size_t pc, bool dirty)
+{
+  switch (repl)
+  {
+    case REPL_SRRIP: insert_victim_impl<srripPolicy>(addr, pc, dirty); break;
+    case REPL_DRRIP: insert_victim_impl<drripPolicy>(addr, pc, dirty); break;
+    case REPL_SHIP:  insert_victim_impl<shipPolicy>(addr, pc, dirty); break;
+    case REPL_DBP:   insert_victim_impl<dbpPolicy>(addr, pc, dirty); break;
+    default:         insert_victim_impl<lruPolicy>(addr, pc, dirty); break;
+  }
+}
+
+template <class Policy>
+void cacheSim::insert_victim_impl(size_t addr, size_t pc, bool dirty)
+{
+  size_t set_idx = (addr >> blk_offs) & ((1 << set_bits) - 1);
+  size_t tag_bits = addr >> (blk_offs + set_bits);
+  std::list<Entry> & set = sets[set_idx];
+
+  for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->tag == tag_bits)
+    {
+      it->dirty |= dirty;
+      set.splice(set.end(), set, it);
+      return;
+    }
+  }
+
+  Entry v_blk;
+  v_blk.tag = tag_bits;
+  v_blk.dirty = dirty;
+  v_blk.pred_dead = false;
+  v_blk.prefetched = false;
+  v_blk.referenced = false;
+  v_blk.refCount = 0;
+  v_blk.rrpv = 0;
+  v_blk.ship_sig = 0;
+  v_blk.pf_src = 0;
+  v_blk.ready = 0;
+  lt_fill(v_blk);
+  Policy::on_insert(repl_state, v_blk, set_idx, pc, false);
+
+  if ((int)set.size() >= set_ways)
+    evict_block<Policy>(set, Policy::choose_victim(repl_state, set, set_idx), set_idx, pc);
+  set.push_back(v_blk);
+}
+
+bool cacheSim::invalidate(size_t addr)
+{
+  size_t set_idx = (addr >> blk_offs) & ((1 << set_bits) - 1);
+  size_t tag_bits = addr >> (blk_offs + set_bits);
+  std::list<Entry> & set = sets[set_idx];
+
+  bool dirty = false;
+  for (size_t c = 0; c < children.size(); c++)
+    dirty |= children[c]->invalidate(addr);
+
+  size_t blk_addr = addr & ~((size_t) block_size_b - 1);
+  bool vc_dirty = false;
+  if (vc && vc->remove(blk_addr, vc_dirty))
+    dirty |= vc_dirty;
+  if (wbb && wbb->remove(blk_addr))
+    dirty = true;
+
+  for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->tag == tag_bits)
+    {
+      dirty |= it->dirty;
+      set.erase(it);
+      back_inval_cnt++;
+      break;
+    }
+  }
+  return dirty;
+}
+
+//fill a ready engine prefetch at the MRU position and fetch it from the next level
+template <class Policy>
+void cacheSim::fill_prefetch(const PfReq & req)
+{
+  size_t set_idx = (req.blk_addr >> blk_offs) & ((1 << set_bits) - 1);
+  size_t tag_bits = req.blk_addr >> (blk_offs + set_bits);
+  std::list<Entry> & set = sets[set_idx];
+
+  //a demand access brought the blk in meanwhile
+  for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->tag == tag_bits)
+    {
+      prefetchers[req.src - 1]->dropped++;
+      return;
+    }
+  }
+
+  Entry p_blk;
+  p_blk.tag = tag_bits;
+  p_blk.dirty = false;
+  p_blk.pred_dead = false;
+  p_blk.prefetched = true;
+  p_blk.referenced = false;
+  p_blk.refCount = 0;
+  p_blk.rrpv = 0;
+  p_blk.ship_sig = 0;
+  p_blk.pf_src = req.src;
+  p_blk.ready = 0;
+  lt_fill(p_blk);
+  Policy::on_insert(repl_state, p_blk, set_idx, req.pc, false);
+
+  if ((int)set.size() >= set_ways)
+    evict_block<Policy>(set, Policy::choose_victim(repl_state, set, set_idx), set_idx, req.pc);
+  set.push_back(p_blk);
+
+  //DBP history update for the prefetched block
+  if(dbp_enable && dbp_use_refcount)
+    insert_on_miss_cnt(*dbp_tbl, req.blk_addr);
+  else if(dbp_enable)
+    insert_on_miss_trace(*dbp_tbl, req.blk_addr, req.pc);
+
+  if (miss_sink)
+    miss_sink->access(req.blk_addr, req.pc, false);
+  else if (parent_cache)
+    parent_cache->access(req.blk_addr, req.pc, false);
+
+  //prefetches occupy MSHRs like demand misses but are off the critical path
+  if (timing)
+  {
+    long now = timing->cycle;
+    long ready = now + tm.hit_latency + tm.alloc_mshr(now) + (parent_cache ? parent_cache->last_latency : timing->mem_latency);
+    tm.fill_mshr(ready);
+    set.back().ready = ready;
+  }
+}
+
+bool cacheSim::is_cached(size_t blk_addr)
+{
+  size_t set_idx = (blk_addr >> blk_offs) & ((1 << set_bits) - 1);
+  size_t tag_bits = blk_addr >> (blk_offs + set_bits);
+  std::list<Entry> & set = sets[set_idx];
+  for (std::list<Entry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->tag == tag_bits)
+      return true;
+  }
+  return false;
+}
+
+//let every engine observe the demand access and queue its new prefetches
+void cacheSim::train_prefetchers(size_t addr, size_t pc, bool miss, int pf_hit_src)
+{
+  size_t blk_mask = ~((size_t) block_size_b - 1);
+  for (size_t i = 0; i < prefetchers.size(); i++)
+  {
+    prefetcher * pf = prefetchers[i];
+    pf_addrs.clear();
+    pf->train(addr, pc, miss, pf_hit_src == (int)(i + 1), pf_addrs);
+
+    for (size_t a = 0; a < pf_addrs.size(); a++)
+    {
+      size_t blk_addr = pf_addrs[a] & blk_mask;
+      bool queued = false;
+      for (std::deque<PfReq>::iterator q = pf_queue.begin(); q != pf_queue.end() && !queued; q++)
+        queued = (q->blk_addr == blk_addr);
+
+      if (queued || pf_queue.size() >= PF_QUEUE_SIZE || is_cached(blk_addr))
+      {
+        pf->dropped++;
+        continue;
+      }
+      PfReq req = { blk_addr, pc, get_access_cnt() + pf_fill_delay, (int)(i + 1) };
+      pf_queue.push_back(req);
+      pf->issued++;
+    }
+  }
 }
 
 //return counters
@@ -287,3 +884,139 @@ long cacheSim::get_useless_pr_cnt()
 {
   return useless_pr_cnt;
 }
+
+long cacheSim::get_bypass_cnt()
+{
+  return bypass_cnt;
+}
+
+long cacheSim::get_back_inval_cnt()
+{
+  return back_inval_cnt;
+}
+
+cacheMetrics cacheSim::metrics(long instrs)
+{
+  cacheMetrics m;
+  double correct = (double)(dbp_cnt - dbp_miss_pred);
+  m.miss_rate = safe_ratio((double) cache_miss, (double) get_access_cnt());
+  m.mpki = safe_ratio(1000.0 * (double) cache_miss, (double) instrs);
+  m.dbp_accuracy = safe_ratio(correct, (double) dbp_cnt);
+  m.dbp_coverage = safe_ratio(correct, (double) evicted_cnt);
+  m.tcp_usefulness = safe_ratio((double)(tcp_pr_cnt - useless_pr_cnt), (double) tcp_pr_cnt);
+  return m;
+}
+
+void cacheSim::register_stats(statsRegistry & reg, const std::string & group, long instrs)
+{
+  reg.add_counter(group, "accesses", get_access_cnt());
+  reg.add_counter(group, "reads", rd_cnt);
+  reg.add_counter(group, "writes", wr_cnt);
+  reg.add_counter(group, "misses", cache_miss);
+  reg.add_counter(group, "evictions", evicted_cnt);
+  reg.add_counter(group, "dbp_predictions", dbp_cnt);
+  reg.add_counter(group, "dbp_mispredictions", dbp_miss_pred);
+  reg.add_counter(group, "tcp_prefetches", tcp_pr_cnt);
+  reg.add_counter(group, "tcp_useless", useless_pr_cnt);
+  reg.add_counter(group, "bypassed_fills", bypass_cnt);
+  reg.add_counter(group, "back_invalidations", back_inval_cnt);
+  reg.add_counter(group, "writebacks_received", wb_cnt);
+  reg.add_counter(group, "writeback_fills", wb_fill_cnt);
+
+  cacheMetrics m = metrics(instrs);
+  reg.add_metric(group, "miss_rate", m.miss_rate);
+  reg.add_metric(group, "mpki", m.mpki);
+  reg.add_metric(group, "dbp_accuracy", m.dbp_accuracy);
+  reg.add_metric(group, "dbp_coverage", m.dbp_coverage);
+  reg.add_metric(group, "tcp_usefulness", m.tcp_usefulness);
+
+  for (size_t i = 0; i < prefetchers.size(); i++)
+    prefetchers[i]->register_stats(reg, group, cache_miss);
+  if (timing)
+  {
+    reg.add_counter(group, "total_latency", tm.total_latency);
+    reg.add_metric(group, "amat", safe_ratio((double) tm.total_latency, (double) get_access_cnt()));
+  }
+}
+
+void cacheSim::merge_stats(const cacheSim & other)
+{
+  rd_cnt += other.rd_cnt;
+  wr_cnt += other.wr_cnt;
+  cache_miss += other.cache_miss;
+  dbp_cnt += other.dbp_cnt;
+  dbp_miss_pred += other.dbp_miss_pred;
+  evicted_cnt += other.evicted_cnt;
+  tcp_pr_cnt += other.tcp_pr_cnt;
+  useless_pr_cnt += other.useless_pr_cnt;
+  bypass_cnt += other.bypass_cnt;
+  back_inval_cnt += other.back_inval_cnt;
+  wb_cnt += other.wb_cnt;
+  wb_fill_cnt += other.wb_fill_cnt;
+#ifdef BLK_LIFETIME_STATS
+  for (int b = 0; b < LT_BINS; b++)
+  {
+    lt.live[b] += other.lt.live[b];
+    lt.dead[b] += other.lt.dead[b];
+    lt.reuse[b] += other.lt.reuse[b];
+    lt.dead_pred[b] += other.lt.dead_pred[b];
+    lt.mispred[b] += other.lt.mispred[b];
+  }
+#endif
+}
+
+#ifdef BLK_LIFETIME_STATS
+//log2 bin of a time: 0 -> 0, [2^(b-1), 2^b) -> b
+static inline int LT_BIN(long t)
+{
+  if (t <= 0)
+    return 0;
+  return std::min(LT_BINS - 1, (int)(8 * sizeof(long)) - __builtin_clzl(t));
+}
+
+//a referenced blk: reuse distance, and a misprediction if it was predicted dead
+//(called before pred_dead is cleared)
+void cacheSim::lt_hit(Entry & blk)
+{
+  long now = get_access_cnt();
+  int b = LT_BIN(now - blk.last_ref);
+  lt.reuse[b]++;
+  if (blk.pred_dead)
+    lt.mispred[b]++;
+  blk.last_ref = now;
+}
+
+void cacheSim::lt_evict(const Entry & blk)
+{
+  int d = LT_BIN(get_access_cnt() - blk.last_ref);
+  lt.live[LT_BIN(blk.last_ref - blk.fill_time)]++;
+  lt.dead[d]++;
+  if (blk.pred_dead)
+    lt.dead_pred[d]++;
+}
+
+//per bin: ACCURACY = correct / (correct + mispredicted) predictions whose blk had been
+//idle that long, COVERAGE = correct predictions / evictions with that dead time.
+//Evictions include dead blks replaced in place by TCP prefetches.
+void cacheSim::report_lifetimes(std::ostream & out, const std::string & name)
+{
+  int last = 0;
+  for (int b = 0; b < LT_BINS; b++)
+  {
+    if (lt.live[b] || lt.dead[b] || lt.reuse[b] || lt.mispred[b])
+      last = b;
+  }
+
+  out << name << " LIFETIMES (log2 bins, in accesses to this cache): " << std::endl;
+  out << name << " BIN  FROM  LIVE  DEAD  REUSE  DBP_CORRECT  DBP_MISPRED  DBP_ACCURACY  DBP_COVERAGE" << std::endl;
+  for (int b = 0; b <= last; b++)
+  {
+    long from = b ? (1L << (b - 1)) : 0;
+    long pred = lt.dead_pred[b] + lt.mispred[b];
+    double acc = pred ? (double) lt.dead_pred[b] / pred : 0.0;
+    double cov = lt.dead[b] ? (double) lt.dead_pred[b] / lt.dead[b] : 0.0;
+    out << name << " " << b << " " << from << " " << lt.live[b] << " " << lt.dead[b] << " " << lt.reuse[b]
+        << " " << lt.dead_pred[b] << " " << lt.mispred[b] << " " << acc << " " << cov << std::endl;
+  }
+}
+#endif
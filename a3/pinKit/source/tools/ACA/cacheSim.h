@@ -3,11 +3,66 @@
 
 #include <map>
 #include <list>
+#include <deque>
 #include <vector>
 #include <iterator>
 #include <cassert>
+#include <string>
 #include <iostream>
 #include "dbpAndPrefetch.h"
+#include "replPolicy.h"
+#include "prefetcher.h"
+#include "timingModel.h"
+#include "cacheStats.h"
+
+class stackDistSim;
+class wbBuffer;
+class victimCache;
+
+//receives the requests a cache sends to its next level (fills and write-backs);
+//used to fan L1 miss streams out to parallel L2 shards instead of parent_cache
+class missSink
+{
+public :
+  virtual ~missSink() {}
+  virtual void access(size_t addr, size_t pc, bool wr_access) = 0;
+  //write-back of a dirty victim; sinks that do not tag write-backs see a write
+  virtual void writeback(size_t blk_addr, size_t pc) { access(blk_addr, pc, true); }
+};
+
+//notified of every blk a cache evicts (e.g. directory bookkeeping)
+class evictListener
+{
+public :
+  virtual ~evictListener() {}
+  virtual void evicted(size_t blk_addr) = 0;
+};
+
+//inclusion property of a cache towards the caches below it (its children)
+//  NINE      : non-inclusive non-exclusive, no coupling (default)
+//  INCLUSIVE : an eviction back-invalidates the blk in all children
+//  EXCLUSIVE : victim cache of the children; filled only with their evictions,
+//              a hit moves the blk up to the requesting child
+enum inclKind
+{
+  INCL_NINE = 0, INCL_INCLUSIVE, INCL_EXCLUSIVE
+};
+
+//Block lifetime instrumentation, compiled in with -DBLK_LIFETIME_STATS.
+//Times are counted in accesses to the cache that holds the blk; histograms use log2
+//bins: bin 0 holds 0, bin b > 0 holds [2^(b-1), 2^b).
+#ifdef BLK_LIFETIME_STATS
+#define LT_BINS 32
+
+struct lifetimeStats
+{
+  long live[LT_BINS];      //fill -> last reference, per evicted blk
+  long dead[LT_BINS];      //last reference -> eviction, per evicted blk
+  long reuse[LT_BINS];     //reuse distance: accesses between two references of a blk
+  long dead_pred[LT_BINS]; //evicted blks predicted dead (correct DBP), by dead time
+  long mispred[LT_BINS];   //hits on blks predicted dead, by time since their last reference
+};
+#endif
 
 //cache block entry struct
 struct Entry
@@ -18,8 +73,28 @@ struct Entry
   bool referenced;  //is this block ever referenced?
   size_t tag;       //block TAG
   unsigned refCount;//reference count
+  unsigned char rrpv;     //re-reference prediction value (RRIP/SHiP)
+  unsigned short ship_sig;//SHiP PC signature of the filling access
+  unsigned char pf_src;   //1 + index of the prefetch engine that filled the blk (0: demand/TCP)
+  long ready;             //cycle the fill completes (timing model)
+#ifdef BLK_LIFETIME_STATS
+  long fill_time;         //access count at the fill
+  long last_ref;          //access count at the last reference (or the fill)
+#endif
 };
 
+//prefetch waiting in a cache's prefetch queue
+struct PfReq
+{
+  size_t blk_addr;
+  size_t pc;      //trigger PC
+  long ready;     //access count at which the block is filled
+  int src;        //1 + engine index
+};
+
+#define PF_QUEUE_SIZE  32  //outstanding engine prefetches per cache
+#define PF_FILL_DELAY  8   //default prefetch latency, in accesses to the cache
+
 
 class cacheSim 
 {
@@ -41,20 +116,107 @@ class cacheSim
 
   long tcp_pr_cnt;     // number of blocks prefetched by TCP
   long useless_pr_cnt; // prefetches that are not referenced
+  long bypass_cnt;     // misses not allocated by the replacement policy
+  long back_inval_cnt; // blocks invalidated by an inclusive parent
+  long wb_cnt;         // write-backs received from the previous level
+  long wb_fill_cnt;    // write-back misses with wb_train off (not in cache_miss)
 
   cacheSim * parent_cache;
 
   std::vector< std::list<Entry> > sets; //cache sets
   std::vector< TagSR > miss_hist;       //keeps track of cache misses in each set 
 
+  replState repl_state;
+
+  //prefetch engines (owned) and their outstanding requests
+  std::vector<prefetcher *> prefetchers;
+  std::deque<PfReq> pf_queue;
+  std::vector<size_t> pf_addrs;
+
+  template <class Policy>
+  void access_impl(size_t, size_t, bool, bool);
+  template <class Policy>
+  void evict_block(std::list<Entry> &, std::list<Entry>::iterator, size_t, size_t);
+  template <class Policy>
+  void fill_prefetch(const PfReq &);
+  bool is_cached(size_t);
+  void train_prefetchers(size_t, size_t, bool, int);
+  void access_exclusive(size_t, size_t, bool);
+  void write_back(size_t, size_t);
+  void send_victim(size_t, size_t, bool);
+  template <class Policy>
+  void insert_victim_impl(size_t, size_t, bool);
+  template <class Policy>
+  void warm_impl(size_t, size_t, bool);
+
+#ifdef BLK_LIFETIME_STATS
+  lifetimeStats lt;
+  void lt_fill(Entry & blk) { blk.fill_time = blk.last_ref = get_access_cnt(); }
+  void lt_hit(Entry &);
+  void lt_evict(const Entry &);
+#else
+  void lt_fill(Entry &) {}
+  void lt_hit(Entry &) {}
+  void lt_evict(const Entry &) {}
+#endif
+
 public :
   //L1: false (uses burstTrace)
   //L2: true  (uses refCount+)
   bool dbp_use_refcount;
 
+  //false: no dead-block prediction (and hence no TCP) in this cache
+  bool dbp_enable;
+
+  //inclusion towards children (see inclKind); children are only needed for INCLUSIVE
+  inclKind inclusion;
+  std::vector<cacheSim *> children;
+
+  //optional MRC consumer of this cache's access stream (NULL: disabled)
+  stackDistSim * mrc;
+
+  //DBP/TCP tables used by this cache (default: the global dbp_tables)
+  dbpTables * dbp_tbl;
+
+  //if set, next-level requests go here instead of parent_cache
+  missSink * miss_sink;
+
+  //optional observer of evictions (NULL: none)
+  evictListener * evict_listener;
+
+  //optional write-back buffer and victim cache towards the next level (NULL: none; owned)
+  wbBuffer * wbb;
+  victimCache * vc;
+
+  //false: write-backs update tags, dirty bits and recency only, without training the
+  //DBP/TCP tables, prefetch engines or replacement policy; their misses count as write-back
+  //fills, not demand misses (true, the default, treats them like demand writes)
+  bool wb_train;
+
+  //replacement policy (default: LRU)
+  replKind repl;
+
+  //engine prefetch latency in accesses to this cache; demand misses on queued blocks are late
+  int pf_fill_delay;
+
+  //optional timing model shared by the hierarchy (NULL: disabled), the latency
+  //configuration/counters of this cache and the latency of the last access
+  timingModel * timing;
+  cacheTiming tm;
+  long last_latency;
+
   cacheSim(int, int, int, cacheSim*);
+  ~cacheSim();
+
+  //attach a prefetch engine; the cache takes ownership
+  void add_prefetcher(prefetcher *);
+  const std::vector<prefetcher *> & get_prefetchers() { return prefetchers; }
 
-  void access(size_t, size_t, bool);
+  //is_wb: the access is a write-back of a dirty victim from the previous level
+  void access(size_t, size_t, bool, bool is_wb = false);
+  //functional warming (sampling): tags, dirty bits and replacement state only, no
+  //DBP/TCP/prefetch training and no counters; misses warm the parent the same way
+  void warm(size_t, size_t, bool);
   long get_access_cnt();
   long get_miss_cnt();
   long get_evicted_cnt();
@@ -63,6 +225,33 @@ public :
 
   long get_tcp_pr_cnt();
   long get_useless_pr_cnt();
+  long get_bypass_cnt();
+  long get_back_inval_cnt();
+  long get_wb_cnt() { return wb_cnt; }
+  long get_wb_fill_cnt() { return wb_fill_cnt; }
+
+  //write the blocks still queued in the write-back buffer to the next level (end of a
+  //run, before reporting); returns the number of blocks drained
+  long drain_write_backs();
+  //drop a blk from this cache and its children; returns true if a dropped copy was dirty
+  bool invalidate(size_t);
+  //receive a child's victim (EXCLUSIVE caches)
+  void insert_victim(size_t, size_t, bool);
+  cacheSim * get_parent() { return parent_cache; }
+
+  //add another cache's counters to this one (merging parallel shards)
+  void merge_stats(const cacheSim &);
+
+  //miss rate, MPKI (instrs: instructions of the run, 0 if unknown), DBP accuracy/coverage
+  //and TCP usefulness; ratios with a zero denominator are 0
+  cacheMetrics metrics(long instrs);
+  //counters, derived metrics and prefetch engines of this cache as values of group
+  void register_stats(statsRegistry & reg, const std::string & group, long instrs);
+
+#ifdef BLK_LIFETIME_STATS
+  //live/dead time and reuse distance histograms, DBP accuracy and coverage per dead-time bin
+  void report_lifetimes(std::ostream &, const std::string &);
+#endif
 };
 
 #endif
@@ -0,0 +1,106 @@
+#include "cacheStats.h"
+#include <cmath>
+#include <iomanip>
+
+void statsRegistry::add_counter(const std::string & group, const std::string & name, long value)
+{
+  statEntry e = { group, name, true, value, 0.0 };
+  entries.push_back(e);
+}
+
+void statsRegistry::add_metric(const std::string & group, const std::string & name, double value)
+{
+  statEntry e = { group, name, false, 0, value };
+  entries.push_back(e);
+}
+
+void statsRegistry::write_value(std::ostream & out, const statEntry & e) const
+{
+  if (e.is_counter)
+    out << e.count;
+  else
+    out << std::setprecision(10) << (std::isfinite(e.metric) ? e.metric : 0.0);
+}
+
+static void json_string(std::ostream & out, const std::string & s)
+{
+  out << '"';
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (c < 0x20)
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec << std::setfill(' ');
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+static void csv_field(std::ostream & out, const std::string & s)
+{
+  if (s.find_first_of(",\"\n") == std::string::npos)
+  {
+    out << s;
+    return;
+  }
+  out << '"';
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    if (s[i] == '"')
+      out << '"';
+    out << s[i];
+  }
+  out << '"';
+}
+
+//groups in order of their first value; a group registered in several parts is still one object
+void statsRegistry::write_json(std::ostream & out) const
+{
+  std::vector<std::string> groups;
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    bool seen = false;
+    for (size_t g = 0; g < groups.size() && !seen; g++)
+      seen = (groups[g] == entries[i].group);
+    if (!seen)
+      groups.push_back(entries[i].group);
+  }
+
+  out << "{";
+  for (size_t g = 0; g < groups.size(); g++)
+  {
+    out << (g ? ",\n  " : "\n  ");
+    json_string(out, groups[g]);
+    out << ": {";
+    bool first = true;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+      if (entries[i].group != groups[g])
+        continue;
+      out << (first ? "\n    " : ",\n    ");
+      first = false;
+      json_string(out, entries[i].name);
+      out << ": ";
+      write_value(out, entries[i]);
+    }
+    out << "\n  }";
+  }
+  out << "\n}" << std::endl;
+}
+
+void statsRegistry::write_csv(std::ostream & out) const
+{
+  out << "group,name,value\n";
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    csv_field(out, entries[i].group);
+    out << ",";
+    csv_field(out, entries[i].name);
+    out << ",";
+    write_value(out, entries[i]);
+    out << "\n";
+  }
+  out.flush();
+}
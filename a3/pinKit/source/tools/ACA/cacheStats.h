@@ -0,0 +1,55 @@
+#ifndef _CACHE_STATS_H_
+#define _CACHE_STATS_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//Machine-readable statistics of a run
+//
+//statsRegistry holds named values in registration order, grouped by component (a cache
+//level, "run"). Components register their own counters (cacheSim::register_stats,
+//prefetcher::register_stats) together with the metrics derived from them; every ratio is
+//0 when its denominator is 0, so the output never contains nan or inf.
+//write_json emits {"group": {"name": value, ...}, ...}, write_csv one "group,name,value"
+//row per value.
+
+//num / den, or 0 when den is 0
+inline double safe_ratio(double num, double den)
+{
+  return den != 0.0 ? num / den : 0.0;
+}
+
+//derived metrics of one cache (cacheSim::metrics)
+struct cacheMetrics
+{
+  double miss_rate;
+  double mpki;             //misses per 1000 instructions (0 without an instruction count)
+  double dbp_accuracy;     //correct dead-block predictions per prediction
+  double dbp_coverage;     //correct dead-block predictions per eviction
+  double tcp_usefulness;   //TCP prefetches referenced before their eviction, per TCP prefetch
+};
+
+class statsRegistry
+{
+  struct statEntry
+  {
+    std::string group;
+    std::string name;
+    bool is_counter;
+    long count;
+    double metric;
+  };
+  std::vector<statEntry> entries;
+
+  void write_value(std::ostream & out, const statEntry & e) const;
+
+public :
+  void add_counter(const std::string & group, const std::string & name, long value);
+  void add_metric(const std::string & group, const std::string & name, double value);
+
+  void write_json(std::ostream & out) const;
+  void write_csv(std::ostream & out) const;
+};
+
+#endif
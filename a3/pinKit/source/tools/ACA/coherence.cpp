@@ -0,0 +1,316 @@
+#include "coherence.h"
+#include <iostream>
+#include <sstream>
+
+static int block_offset_bits(int b_sz_b)
+{
+  int offs = 0;
+  while ((1 << offs) < b_sz_b)
+    offs++;
+  return offs;
+}
+
+/* ===================================================================== */
+/* shared L2                                                             */
+/* ===================================================================== */
+
+sharedCache::sharedCache(int t_sz_kb, int b_sz_b, int ways, int n_stripes, replKind repl)
+{
+  size_t num_sets = ((size_t) t_sz_kb * 1024 / b_sz_b) / ways;
+  set_mask = num_sets - 1;
+  blk_offs = block_offset_bits(b_sz_b);
+
+  if (n_stripes < 1)
+    n_stripes = 1;
+  for (int i = 0; i < n_stripes; i++)
+  {
+    Stripe * s = new Stripe();
+    s->cache = new cacheSim(t_sz_kb, b_sz_b, ways, 0);
+    s->cache->dbp_use_refcount = true;
+    s->cache->repl = repl;
+    s->cache->dbp_tbl = &s->tbl;
+    stripes.push_back(s);
+  }
+}
+
+sharedCache::~sharedCache()
+{
+  for (size_t i = 0; i < stripes.size(); i++)
+  {
+    delete stripes[i]->cache;
+    delete stripes[i];
+  }
+}
+
+void sharedCache::access(size_t addr, size_t pc, bool wr_access)
+{
+  size_t set_idx = (addr >> blk_offs) & set_mask;
+  Stripe & s = *stripes[set_idx % stripes.size()];
+  s.lock.lock();
+  s.cache->access(addr, pc, wr_access);
+  s.lock.unlock();
+}
+
+void sharedCache::writeback(size_t blk_addr, size_t pc)
+{
+  size_t set_idx = (blk_addr >> blk_offs) & set_mask;
+  Stripe & s = *stripes[set_idx % stripes.size()];
+  s.lock.lock();
+  s.cache->access(blk_addr, pc, true, true);
+  s.lock.unlock();
+}
+
+void sharedCache::merge_stats(cacheSim & total)
+{
+  for (size_t i = 0; i < stripes.size(); i++)
+    total.merge_stats(*stripes[i]->cache);
+}
+
+/* ===================================================================== */
+/* private caches of one core                                            */
+/* ===================================================================== */
+
+coreState::coreState(coherentSystem * s, int core_id)
+ : sys(s), inv_pending(false), id(core_id), instrs(0), coherence_misses(0), inv_received(0),
+   inv_sent(0), interventions(0)
+{
+  l1i = new cacheSim(s->l1_kb, s->l1_b, s->l1_w, 0);
+  l1d = new cacheSim(s->l1_kb, s->l1_b, s->l1_w, 0);
+  cacheSim * l1[2] = { l1i, l1d };
+  for (int i = 0; i < 2; i++)
+  {
+    l1[i]->repl = s->repl;
+    l1[i]->dbp_tbl = &tbl;
+    l1[i]->miss_sink = this;
+  }
+  l1d->evict_listener = this;
+
+  std::vector<prefetcher *> engines;
+  parse_prefetchers(s->pf_spec, engines);
+  for (size_t i = 0; i < engines.size(); i++)
+    l1d->add_prefetcher(engines[i]);
+  l1d->pf_fill_delay = s->pf_fill_delay;
+}
+
+coreState::~coreState()
+{
+  delete l1i;
+  delete l1d;
+}
+
+void coreState::access(size_t addr, size_t pc, bool wr_access)
+{
+  sys->l2->access(addr, pc, wr_access);
+}
+
+void coreState::writeback(size_t blk_addr, size_t pc)
+{
+  sys->l2->writeback(blk_addr, pc);
+}
+
+void coreState::evicted(size_t blk_addr)
+{
+  sys->dir_evict(this, blk_addr);
+}
+
+void coreState::post_invalidation(size_t blk_addr)
+{
+  inv_lock.lock();
+  inv_queue.push_back(blk_addr);
+  inv_pending.store(true, std::memory_order_release);
+  inv_lock.unlock();
+}
+
+//apply the invalidations other cores posted since the last access of this thread
+void coreState::drain_invalidations()
+{
+  if (!inv_pending.load(std::memory_order_acquire))
+    return;
+
+  std::vector<size_t> blks;
+  inv_lock.lock();
+  blks.swap(inv_queue);
+  inv_pending.store(false, std::memory_order_relaxed);
+  inv_lock.unlock();
+
+  for (size_t i = 0; i < blks.size(); i++)
+  {
+    long before = l1d->get_back_inval_cnt();
+    l1d->invalidate(blks[i]);
+    if (l1d->get_back_inval_cnt() != before)
+    {
+      inv_received++;
+      lost.insert(blks[i]);
+    }
+  }
+}
+
+/* ===================================================================== */
+/* directory and coherent accesses                                       */
+/* ===================================================================== */
+
+coherentSystem::coherentSystem(int l1_kb, int l1_b, int l1_w, int l2_kb, int l2_b, int l2_w, int stripes,
+                               replKind repl, const std::string & pf_spec)
+ : l1_kb(l1_kb), l1_b(l1_b), l1_w(l1_w), repl(repl), pf_spec(pf_spec), pf_fill_delay(PF_FILL_DELAY)
+{
+  blk_offs = block_offset_bits(l1_b);
+  l2 = new sharedCache(l2_kb, l2_b, l2_w, stripes, repl);
+  for (int i = 0; i < MAX_CORES; i++)
+    cores[i] = 0;
+  for (int i = 0; i < (stripes < 1 ? 1 : stripes); i++)
+    dir.push_back(new DirStripe());
+}
+
+coherentSystem::~coherentSystem()
+{
+  for (int i = 0; i < MAX_CORES; i++)
+    delete cores[i];
+  for (size_t i = 0; i < dir.size(); i++)
+    delete dir[i];
+  delete l2;
+}
+
+//every thread adds itself, so no two calls share a slot
+coreState * coherentSystem::add_core(int core_id)
+{
+  if (core_id < 0 || core_id >= MAX_CORES)
+    return 0;
+  if (!cores[core_id])
+    cores[core_id] = new coreState(this, core_id);
+  return cores[core_id];
+}
+
+//a read fill: add a sharer, an M copy elsewhere is downgraded to S
+void coherentSystem::dir_read(coreState * core, size_t blk_addr)
+{
+  DirStripe & ds = dir_stripe(blk_addr);
+  ds.lock.lock();
+  std::unordered_map<size_t, DirEntry>::iterator it = ds.map.find(blk_addr);
+  if (it == ds.map.end())
+  {
+    DirEntry e = { 0, -1 };
+    it = ds.map.insert(std::make_pair(blk_addr, e)).first;
+  }
+  if (it->second.owner >= 0 && it->second.owner != core->id)
+  {
+    core->interventions++;
+    it->second.owner = -1;
+  }
+  it->second.sharers |= (uint64_t) 1 << core->id;
+  ds.lock.unlock();
+}
+
+//a write: invalidate all other copies and take the blk in M
+void coherentSystem::dir_write(coreState * core, size_t blk_addr)
+{
+  DirStripe & ds = dir_stripe(blk_addr);
+  ds.lock.lock();
+  DirEntry & e = ds.map[blk_addr];
+  if (e.sharers == 0)
+    e.owner = -1;
+  uint64_t others = e.sharers & ~((uint64_t) 1 << core->id);
+  for (int c = 0; others != 0; c++, others >>= 1)
+  {
+    if (others & 1)
+    {
+      cores[c]->post_invalidation(blk_addr);
+      core->inv_sent++;
+    }
+  }
+  e.sharers = (uint64_t) 1 << core->id;
+  e.owner = core->id;
+  ds.lock.unlock();
+}
+
+void coherentSystem::dir_evict(coreState * core, size_t blk_addr)
+{
+  DirStripe & ds = dir_stripe(blk_addr);
+  ds.lock.lock();
+  std::unordered_map<size_t, DirEntry>::iterator it = ds.map.find(blk_addr);
+  if (it != ds.map.end())
+  {
+    it->second.sharers &= ~((uint64_t) 1 << core->id);
+    if (it->second.owner == core->id)
+      it->second.owner = -1;
+    if (it->second.sharers == 0)
+      ds.map.erase(it);
+  }
+  ds.lock.unlock();
+}
+
+void coherentSystem::ifetch(coreState * core, size_t pc)
+{
+  core->drain_invalidations();
+  core->instrs++;
+  core->l1i->access(pc, pc, false);
+}
+
+void coherentSystem::read(coreState * core, size_t addr, size_t pc)
+{
+  core->drain_invalidations();
+  size_t blk_addr = (addr >> blk_offs) << blk_offs;
+  long misses = core->l1d->get_miss_cnt();
+  core->l1d->access(addr, pc, false);
+  if (core->l1d->get_miss_cnt() != misses)
+  {
+    if (core->lost.erase(blk_addr))
+      core->coherence_misses++;
+    dir_read(core, blk_addr);
+  }
+}
+
+void coherentSystem::write(coreState * core, size_t addr, size_t pc)
+{
+  core->drain_invalidations();
+  size_t blk_addr = (addr >> blk_offs) << blk_offs;
+  dir_write(core, blk_addr);
+  long misses = core->l1d->get_miss_cnt();
+  core->l1d->access(addr, pc, true);
+  if (core->l1d->get_miss_cnt() != misses && core->lost.erase(blk_addr))
+    core->coherence_misses++;
+}
+
+void coherentSystem::merge_stats(cacheSim & l1i_total, cacheSim & l1d_total, cacheSim & l2_total)
+{
+  for (int i = 0; i < MAX_CORES; i++)
+  {
+    if (!cores[i])
+      continue;
+    l1i_total.merge_stats(*cores[i]->l1i);
+    l1d_total.merge_stats(*cores[i]->l1d);
+  }
+  l2->merge_stats(l2_total);
+}
+
+void coherentSystem::report(std::ostream & out)
+{
+  long coh_misses = 0, invs = 0, interv = 0;
+  for (int i = 0; i < MAX_CORES; i++)
+  {
+    coreState * c = cores[i];
+    if (!c)
+      continue;
+    std::ostringstream name;
+    name << "THREAD " << i;
+    std::string p = name.str();
+    out << std::endl;
+    out << p << " INSTRUCTIONS: " << c->instrs << std::endl;
+    out << p << " L1-I ACCESS COUNT: " << c->l1i->get_access_cnt() << std::endl;
+    out << p << " L1-I MISS COUNT: " << c->l1i->get_miss_cnt() << std::endl;
+    out << p << " L1-D ACCESS COUNT: " << c->l1d->get_access_cnt() << std::endl;
+    out << p << " L1-D MISS COUNT: " << c->l1d->get_miss_cnt() << std::endl;
+    out << p << " COHERENCE MISSES: " << c->coherence_misses << std::endl;
+    out << p << " INVALIDATIONS RECEIVED: " << c->inv_received << std::endl;
+    out << p << " INVALIDATIONS SENT: " << c->inv_sent << std::endl;
+    out << p << " INTERVENTIONS: " << c->interventions << std::endl;
+    for (size_t k = 0; k < c->l1d->get_prefetchers().size(); k++)
+      c->l1d->get_prefetchers()[k]->report(out, p + " L1-D", c->l1d->get_miss_cnt());
+    coh_misses += c->coherence_misses;
+    invs += c->inv_received;
+    interv += c->interventions;
+  }
+  out << std::endl;
+  out << "COHERENCE MISSES: " << coh_misses << std::endl;
+  out << "INVALIDATIONS: " << invs << std::endl;
+  out << "INTERVENTIONS: " << interv << std::endl;
+}
@@ -0,0 +1,185 @@
+#ifndef _COHERENCE_H_
+#define _COHERENCE_H_
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+#include <sched.h>
+#include "cacheSim.h"
+
+//Multi-threaded hierarchy: per-thread private L1-I/L1-D, a shared L2 and an MSI directory
+//
+//The shared L2 is split into lock stripes by set index (set_idx % stripes). Every stripe
+//is a full-geometry cacheSim with private DBP/TCP tables and replacement state that only
+//ever sees its own sets. For policies without cross-set state (lru, srrip) a
+//single-threaded run gives the same L2 counters as one cacheSim; drrip, ship and dbp
+//would train a separate PSEL, SHCT or bypass throttle per stripe, so dbpSim rejects
+//them under -mt (see repl_shares_state).
+//
+//The directory tracks the L1-D copies of every block (sharer bit vector + M owner). A
+//write invalidates the other sharers by posting the block to their invalidation queue;
+//each thread drains its own queue before every access, so an L1 is only ever touched by
+//its owning thread and no lock is held while a cache is accessed (no lock ordering, no
+//deadlock). A later miss of a thread on a block it lost this way is a coherence miss.
+//
+//There is no E state: a read fill is S even when no other core holds the blk, and every
+//write goes through the directory (dir_write), so no upgrade is ever silent.
+//
+//Only demand reads and writes add sharers; prefetched L1 copies (TCP or engine fills)
+//are not tracked. Every L1-D eviction, including the dead blk a TCP prefetch replaces,
+//clears the core's sharer bit (dir_evict).
+
+#define MAX_CORES 64 //width of the sharer bit vector
+
+//test-and-test-and-set lock; holders never block on another lock. Waiters yield the
+//CPU after a short spin, as the application may run more threads than there are cores.
+class spinLock
+{
+  std::atomic<bool> held;
+
+public :
+  spinLock() : held(false) {}
+  void lock()
+  {
+    int spins = 0;
+    while (true)
+    {
+      if (!held.exchange(true, std::memory_order_acquire))
+        return;
+      while (held.load(std::memory_order_relaxed))
+      {
+        if (++spins > 64)
+          sched_yield();
+      }
+    }
+  }
+  void unlock() { held.store(false, std::memory_order_release); }
+};
+
+//set-striped shared cache; used as the miss sink of all private L1s
+class sharedCache : public missSink
+{
+  struct Stripe
+  {
+    spinLock lock;
+    dbpTables tbl;
+    cacheSim * cache;
+    char pad[64];
+  };
+  std::vector<Stripe *> stripes;
+  int blk_offs;
+  size_t set_mask;
+
+public :
+  sharedCache(int t_sz_kb, int b_sz_b, int ways, int n_stripes, replKind repl);
+  ~sharedCache();
+
+  void access(size_t addr, size_t pc, bool wr_access);
+  void writeback(size_t blk_addr, size_t pc);
+
+  //sum of all stripes' counters (into a cacheSim of the same geometry)
+  void merge_stats(cacheSim & total);
+};
+
+struct DirEntry
+{
+  uint64_t sharers;  //L1-D copies
+  int owner;         //core holding the blk in M (-1: none)
+};
+
+class coherentSystem;
+
+//one simulated core (application thread); only its own thread touches its L1s
+class coreState : public missSink, public evictListener
+{
+  friend class coherentSystem;
+
+  coherentSystem * sys;
+
+  //invalidations posted by other cores
+  spinLock inv_lock;
+  std::vector<size_t> inv_queue;
+  std::atomic<bool> inv_pending;
+
+  std::unordered_set<size_t> lost;  //blks invalidated by other cores' writes
+
+  void drain_invalidations();
+
+public :
+  int id;
+  cacheSim * l1i;
+  cacheSim * l1d;
+  dbpTables tbl;           //private L1 predictor tables
+
+  long instrs;
+  long coherence_misses;
+  long inv_received;       //L1-D copies invalidated by other cores' writes
+  long inv_sent;           //invalidations this core's writes posted
+  long interventions;      //reads that downgraded another core's M copy
+
+  coreState(coherentSystem * s, int core_id);
+  ~coreState();
+
+  //missSink: L1 fills and write-backs go to the shared L2
+  void access(size_t addr, size_t pc, bool wr_access);
+  void writeback(size_t blk_addr, size_t pc);
+  //evictListener: the L1-D dropped a blk
+  void evicted(size_t blk_addr);
+
+  //queue an invalidation for the owning thread (called by other cores)
+  void post_invalidation(size_t blk_addr);
+};
+
+class coherentSystem
+{
+  friend class coreState;
+
+  int l1_kb, l1_b, l1_w;
+  replKind repl;
+  std::string pf_spec;
+  int blk_offs;
+
+  sharedCache * l2;
+  coreState * cores[MAX_CORES];     //indexed by core id (NULL: unused)
+
+  //directory, striped like the L2
+  struct DirStripe
+  {
+    spinLock lock;
+    std::unordered_map<size_t, DirEntry> map;
+    char pad[64];
+  };
+  std::vector<DirStripe *> dir;
+
+  DirStripe & dir_stripe(size_t blk_addr) { return *dir[(blk_addr >> blk_offs) % dir.size()]; }
+  void dir_read(coreState * core, size_t blk_addr);
+  void dir_write(coreState * core, size_t blk_addr);
+  void dir_evict(coreState * core, size_t blk_addr);
+
+public :
+  //engine prefetch latency of the L1-Ds (set before the first add_core)
+  int pf_fill_delay;
+
+  coherentSystem(int l1_kb, int l1_b, int l1_w, int l2_kb, int l2_b, int l2_w, int stripes,
+                 replKind repl, const std::string & pf_spec);
+  ~coherentSystem();
+
+  //create the private caches of a new thread; NULL if core_id >= MAX_CORES
+  coreState * add_core(int core_id);
+
+  void ifetch(coreState * core, size_t pc);
+  void read(coreState * core, size_t addr, size_t pc);
+  void write(coreState * core, size_t addr, size_t pc);
+
+  //core with the given id (NULL: none)
+  coreState * core(int core_id) { return cores[core_id]; }
+
+  //aggregate counters into caches of the L1/L2 geometries
+  void merge_stats(cacheSim & l1i_total, cacheSim & l1d_total, cacheSim & l2_total);
+  void report(std::ostream & out);
+};
+
+#endif
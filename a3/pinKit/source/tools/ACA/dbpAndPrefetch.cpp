@@ -1,31 +1,29 @@
 #include "dbpAndPrefetch.h" 
 
-std::map <size_t, TraceEntry> tr_hist_tbl; //accessed by L1-I and L1-D caches
-std::map <size_t, RefEntry> ref_hist_tbl;  //accessed by L2 cache
-std::map <size_t, std::list<PredEntry> > l1_tcp_pred_tbl; //TCP correlation table for L1 I/D caches
-std::map <size_t, std::list<PredEntry> > l2_tcp_pred_tbl; //TCP correlation table for L2 combined cache
+//tr_hist_tbl: accessed by L1-I and L1-D caches; ref_hist_tbl: accessed by L2 cache
+dbpTables dbp_tables;
 
 bool TcpEnabled = false;
 
 //Update BurstTrace from a cache hit
-void update_trace(size_t blk_addr, size_t pc)
+void update_trace(dbpTables & tbl, size_t blk_addr, size_t pc)
 {
-    if(tr_hist_tbl.find(blk_addr) == tr_hist_tbl.end()) 
+    if(tbl.tr_hist_tbl.find(blk_addr) == tbl.tr_hist_tbl.end()) 
     {
       std::cout << "BLK_ADDR:" << blk_addr << std::endl;
       std::cout << "PC:" << pc << std::endl;
     }
-    assert(tr_hist_tbl.find(blk_addr) != tr_hist_tbl.end());
-    tr_hist_tbl[blk_addr].current_trace += pc;
-    tr_hist_tbl[blk_addr].current_trace &= ((1 << 30) - 1);
+    assert(tbl.tr_hist_tbl.find(blk_addr) != tbl.tr_hist_tbl.end());
+    tbl.tr_hist_tbl[blk_addr].current_trace += pc;
+    tbl.tr_hist_tbl[blk_addr].current_trace &= ((1 << 30) - 1);
 }
 
 //Predict if a given block is dead after a cache access based on BurstTrace
-bool predict_db_trace(size_t blk_addr)
+bool predict_db_trace(dbpTables & tbl, size_t blk_addr)
 {
-  if (tr_hist_tbl.find(blk_addr) != tr_hist_tbl.end())
+  if (tbl.tr_hist_tbl.find(blk_addr) != tbl.tr_hist_tbl.end())
   {
-    if((tr_hist_tbl[blk_addr].current_trace == tr_hist_tbl[blk_addr].old_trace) && tr_hist_tbl[blk_addr].confidence)
+    if((tbl.tr_hist_tbl[blk_addr].current_trace == tbl.tr_hist_tbl[blk_addr].old_trace) && tbl.tr_hist_tbl[blk_addr].confidence)
     {
       return true;
     }
@@ -34,12 +32,12 @@ bool predict_db_trace(size_t blk_addr)
 }
 
 //Predict if a given block is dead after a cache burst
-bool predict_db_cnt(size_t blk_addr, int ref_cnt)
+bool predict_db_cnt(dbpTables & tbl, size_t blk_addr, int ref_cnt)
 {
-  if (ref_hist_tbl.find(blk_addr) != ref_hist_tbl.end())
+  if (tbl.ref_hist_tbl.find(blk_addr) != tbl.ref_hist_tbl.end())
   {
-    if((ref_hist_tbl[blk_addr].dead_cnt == ref_cnt) &&
-    (ref_hist_tbl[blk_addr].sat_cnt == 1 || ref_hist_tbl[blk_addr].filter_cnt >  0))
+    if((tbl.ref_hist_tbl[blk_addr].dead_cnt == ref_cnt) &&
+    (tbl.ref_hist_tbl[blk_addr].sat_cnt == 1 || tbl.ref_hist_tbl[blk_addr].filter_cnt >  0))
     {
       return true;
     }
@@ -48,24 +46,24 @@ bool predict_db_cnt(size_t blk_addr, int ref_cnt)
 }
 
 //Insert a new entry to RefCount+ history table on a L2 cache miss
-void insert_on_miss_cnt(size_t blk_addr)
+void insert_on_miss_cnt(dbpTables & tbl, size_t blk_addr)
 {
-    if (ref_hist_tbl.find(blk_addr) == ref_hist_tbl.end())
+    if (tbl.ref_hist_tbl.find(blk_addr) == tbl.ref_hist_tbl.end())
     {
        RefEntry new_tr;
        new_tr.sat_cnt = 0;
        new_tr.dead_cnt = 0;
        new_tr.filter_cnt = 0;
-       ref_hist_tbl[blk_addr] = new_tr;
+       tbl.ref_hist_tbl[blk_addr] = new_tr;
     }
 }
 
 //Insert a new entry to BurstTrace history table on a L1 cache miss
-void insert_on_miss_trace(size_t blk_addr, size_t pc)
+void insert_on_miss_trace(dbpTables & tbl, size_t blk_addr, size_t pc)
 {
-    if (tr_hist_tbl.find(blk_addr) != tr_hist_tbl.end() )
+    if (tbl.tr_hist_tbl.find(blk_addr) != tbl.tr_hist_tbl.end() )
     {
-       tr_hist_tbl[blk_addr].current_trace = 0;
+       tbl.tr_hist_tbl[blk_addr].current_trace = 0;
     }
     else //create new entry
     {
@@ -74,56 +72,56 @@ void insert_on_miss_trace(size_t blk_addr, size_t pc)
        new_tr.current_trace = 0;
 
        new_tr.old_trace = 0;
-       tr_hist_tbl[blk_addr] = new_tr;
+       tbl.tr_hist_tbl[blk_addr] = new_tr;
     }
 }
 
 //Update RefCount+ history table on a L2 cache miss
-void update_on_eviction_cnt(size_t blk_addr, int ref_cnt)
+void update_on_eviction_cnt(dbpTables & tbl, size_t blk_addr, int ref_cnt)
 {
    //on eviction, update trace
-   if (ref_hist_tbl.find(blk_addr) != ref_hist_tbl.end() ) {
-     if(ref_hist_tbl[blk_addr].dead_cnt < ref_cnt)
+   if (tbl.ref_hist_tbl.find(blk_addr) != tbl.ref_hist_tbl.end() ) {
+     if(tbl.ref_hist_tbl[blk_addr].dead_cnt < ref_cnt)
      {
-       ref_hist_tbl[blk_addr].sat_cnt = 0;
-       ref_hist_tbl[blk_addr].dead_cnt = ref_cnt;
-     } else if (ref_cnt == ref_hist_tbl[blk_addr].dead_cnt) {
-       ref_hist_tbl[blk_addr].sat_cnt = 1;
-     } else if (ref_cnt < ref_hist_tbl[blk_addr].dead_cnt) {
+       tbl.ref_hist_tbl[blk_addr].sat_cnt = 0;
+       tbl.ref_hist_tbl[blk_addr].dead_cnt = ref_cnt;
+     } else if (ref_cnt == tbl.ref_hist_tbl[blk_addr].dead_cnt) {
+       tbl.ref_hist_tbl[blk_addr].sat_cnt = 1;
+     } else if (ref_cnt < tbl.ref_hist_tbl[blk_addr].dead_cnt) {
        //RefCount+ logic: preventing lower RefCount from resetting confidence
-       if (ref_cnt == ref_hist_tbl[blk_addr].filter_cnt) 
+       if (ref_cnt == tbl.ref_hist_tbl[blk_addr].filter_cnt) 
        {
-         ref_hist_tbl[blk_addr].sat_cnt = 1;
-         ref_hist_tbl[blk_addr].dead_cnt = ref_cnt;
+         tbl.ref_hist_tbl[blk_addr].sat_cnt = 1;
+         tbl.ref_hist_tbl[blk_addr].dead_cnt = ref_cnt;
        }
        else
        {
-         ref_hist_tbl[blk_addr].sat_cnt = 0;
-         ref_hist_tbl[blk_addr].filter_cnt = ref_cnt;
+         tbl.ref_hist_tbl[blk_addr].sat_cnt = 0;
+         tbl.ref_hist_tbl[blk_addr].filter_cnt = ref_cnt;
        }
      }
    }
 }
 
 //Update BurstTrace history table on a L1 cache miss
-void update_on_eviction_trace(size_t blk_addr)
+void update_on_eviction_trace(dbpTables & tbl, size_t blk_addr)
 {
    //on eviction, update trace
-   if (tr_hist_tbl.find(blk_addr) != tr_hist_tbl.end() ) {
-     if(tr_hist_tbl[blk_addr].current_trace == tr_hist_tbl[blk_addr].old_trace) {
-       tr_hist_tbl[blk_addr].confidence = true;
+   if (tbl.tr_hist_tbl.find(blk_addr) != tbl.tr_hist_tbl.end() ) {
+     if(tbl.tr_hist_tbl[blk_addr].current_trace == tbl.tr_hist_tbl[blk_addr].old_trace) {
+       tbl.tr_hist_tbl[blk_addr].confidence = true;
      } else {
-       tr_hist_tbl[blk_addr].confidence = false;
+       tbl.tr_hist_tbl[blk_addr].confidence = false;
      }
-     tr_hist_tbl[blk_addr].old_trace = tr_hist_tbl[blk_addr].current_trace;
-     tr_hist_tbl[blk_addr].current_trace = 0;
+     tbl.tr_hist_tbl[blk_addr].old_trace = tbl.tr_hist_tbl[blk_addr].current_trace;
+     tbl.tr_hist_tbl[blk_addr].current_trace = 0;
    }
 }
 
 //update TCP correlation table; use_ref_cnt to differentiate L1 and L2 caches
-void update_tc_tbl(TagSR tag_sr, size_t tag, int blk_offs, int set_bits, bool use_ref_cnt)
+void update_tc_tbl(dbpTables & tbl, TagSR tag_sr, size_t tag, int blk_offs, int set_bits, bool use_ref_cnt)
 {
-  std::map <size_t, std::list<PredEntry> > & tcp_pred_tbl = (use_ref_cnt) ? l2_tcp_pred_tbl : l1_tcp_pred_tbl;
+  std::map <size_t, std::list<PredEntry> > & tcp_pred_tbl = (use_ref_cnt) ? tbl.l2_tcp_pred_tbl : tbl.l1_tcp_pred_tbl;
 
   if (tag_sr.valid_0 && tag_sr.valid_1 && TcpEnabled )
   {
@@ -157,9 +155,9 @@ void update_tc_tbl(TagSR tag_sr, size_t tag, int blk_offs, int set_bits, bool us
 }
 
 //trigger a TC prefetch, and return the tag of pre-fetched block
-size_t tcp_prefetch(TagSR tag_sr, int blk_offs, int set_bits, bool use_ref_cnt, bool * did_prefetch)
+size_t tcp_prefetch(dbpTables & tbl, TagSR tag_sr, int blk_offs, int set_bits, bool use_ref_cnt, bool * did_prefetch)
 {
-    std::map <size_t, std::list<PredEntry> > & tcp_pred_tbl = (use_ref_cnt) ? l2_tcp_pred_tbl : l1_tcp_pred_tbl;
+    std::map <size_t, std::list<PredEntry> > & tcp_pred_tbl = (use_ref_cnt) ? tbl.l2_tcp_pred_tbl : tbl.l1_tcp_pred_tbl;
     unsigned max_cnt = 0;
     size_t prefetch_tag = 0;
     if (tag_sr.valid_0 && tag_sr.valid_1 && TcpEnabled)
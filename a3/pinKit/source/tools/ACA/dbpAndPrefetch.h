@@ -40,28 +40,36 @@ struct TagSR
 };
 
 
-//BurstTrace History Table for L1 cache dead-block prediction
-extern std::map <size_t, TraceEntry> tr_hist_tbl;
+//predictor state of a cache hierarchy; one instance per independent partition
+//(the sequential simulator uses dbp_tables, parallel L2 shards own private copies)
+struct dbpTables
+{
+  //BurstTrace History Table for L1 cache dead-block prediction
+  std::map <size_t, TraceEntry> tr_hist_tbl;
+
+  //RefCount+ History Table for L2 cache dead-block prediction
+  std::map <size_t, RefEntry> ref_hist_tbl;
 
-//RefCount+ History Table for L1 cache dead-block prediction
-extern std::map <size_t, RefEntry> ref_hist_tbl;
+  //TCP: correlation tables for L1 I/D caches and the L2 combined cache
+  std::map <size_t, std::list<PredEntry> > l1_tcp_pred_tbl;
+  std::map <size_t, std::list<PredEntry> > l2_tcp_pred_tbl;
+};
 
-//TCP: correlation table for TCP access
-extern std::map <size_t, std::list<PredEntry> > tcp_pred_tbl;
+extern dbpTables dbp_tables;
 
 extern bool TcpEnabled;
 extern bool UseCacheBurst;
 
 //update trace and return true if the block is predicted to be dead
-void update_trace (size_t blk_addr, size_t pc);
-bool predict_db_trace (size_t blk_addr);
-bool predict_db_cnt(size_t blk_addr, int ref_cnt);
-void insert_on_miss_trace(size_t blk_addr, size_t pc);
-void insert_on_miss_cnt(size_t blk_addr);
-void update_on_eviction_trace(size_t blk_add);
-void update_on_eviction_cnt(size_t blk_add, int ref_cnt);
+void update_trace (dbpTables & tbl, size_t blk_addr, size_t pc);
+bool predict_db_trace (dbpTables & tbl, size_t blk_addr);
+bool predict_db_cnt(dbpTables & tbl, size_t blk_addr, int ref_cnt);
+void insert_on_miss_trace(dbpTables & tbl, size_t blk_addr, size_t pc);
+void insert_on_miss_cnt(dbpTables & tbl, size_t blk_addr);
+void update_on_eviction_trace(dbpTables & tbl, size_t blk_add);
+void update_on_eviction_cnt(dbpTables & tbl, size_t blk_add, int ref_cnt);
 
-void update_tc_tbl(TagSR tag_sr, size_t tag, int blk_offs, int set_bits, bool use_ref_cnt);
-size_t tcp_prefetch(TagSR tag_sr, int blk_offs, int set_bits, bool use_ref_cnt, bool * prefetched);
+void update_tc_tbl(dbpTables & tbl, TagSR tag_sr, size_t tag, int blk_offs, int set_bits, bool use_ref_cnt);
+size_t tcp_prefetch(dbpTables & tbl, TagSR tag_sr, int blk_offs, int set_bits, bool use_ref_cnt, bool * prefetched);
 
 #endif
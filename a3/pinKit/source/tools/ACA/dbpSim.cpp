@@ -45,6 +45,14 @@ END_LEGAL */
 #include "cacheSim.h"
 #include "gzstream.hpp"
 #include "dbpAndPrefetch.h"
+#include "stackDist.h"
+#include "accessTrace.h"
+#include "hierBuilder.h"
+#include "coherence.h"
+#include "sampling.h"
+#include "intervalStats.h"
+#include "tlbSim.h"
+#include "wbBuffer.h"
 
 #include <iostream>
 #include <fstream>
@@ -55,12 +63,70 @@ END_LEGAL */
 /* Global Variables */
 /* ===================================================================== */
 gz::ogzstream TraceFile;
+gz::ogzstream AccessTraceFile;
+static traceWriter AccessTrace;
 static UINT64 instCount = 0;
 
 cacheSim * L1_I_CACHE;
 cacheSim * L1_D_CACHE;
 cacheSim * L2_CACHE;
 
+stackDistSim * L1_I_MRC;
+stackDistSim * L1_D_MRC;
+stackDistSim * L2_MRC;
+
+timingModel * Timing;
+
+//-tlb: translation in front of the L1s (the caches then see physical addresses)
+mmuSim * Mmu;
+
+//set when the hierarchy comes from a -hier file (L2_CACHE is then the parent of the L1-D)
+cacheHierarchy * Hier;
+
+//-mt: private L1s per application thread, shared L2 and directory
+coherentSystem * MtSys;
+
+//per-thread state of -mt runs (Pin TLS)
+struct threadData
+{
+    VOID * write_addr;
+    coreState * core;   //NULL: thread id beyond MAX_CORES, not simulated
+};
+static TLS_KEY MtKey;
+static UINT32 MtUnsimulated = 0;
+static UINT32 NumThreads = 0;
+
+//region of interest: only instructions inside it are instrumented for the caches
+enum roiState
+{
+  ROI_WAIT = 0,   //waiting for a begin marker / routine
+  ROI_SKIP,       //fast-forwarding -skip instructions
+  ROI_SIM,        //simulating
+  ROI_DONE        //ended, no more simulation
+};
+static roiState RoiState = ROI_SIM;
+static INT64 RoiLeft;          //instructions left to skip (ROI_SKIP) or simulate (ROI_SIM, -simlen)
+static UINT64 RoiSkipped = 0;
+static UINT64 RoiSimulated = 0;
+static UINT32 RoiCount = 0;
+static INT32 RoiRtnDepth = 0;
+static BOOL RoiDetaching = false;
+
+//-interval / -bbv: per-interval CSV rows and SimPoint basic-block vectors
+gz::ogzstream IntervalFile;
+gz::ogzstream BbvFile;
+intervalRecorder * Intervals;
+bbvProfile * Bbv;
+static std::map<ADDRINT, UINT32> BblIds;
+static INT64 IntervalLeft;
+static UINT64 IntervalInstrs = 0;
+
+//-sample: phase state read by the inlined If-routines
+smartsSampler * Sampler;
+static INT64 PhaseLeft;
+static ADDRINT InDetailed;
+static ADDRINT InWarming;
+
 /* ===================================================================== */
 /* Commandline Switches */
 /* ===================================================================== */
@@ -68,6 +134,12 @@ KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool",
     "o", "pinMemTrace.txt.gz", "specify trace file name");
 KNOB<BOOL> KnobValues(KNOB_MODE_WRITEONCE, "pintool",
     "values", "1", "Output memory values reads and written");
+KNOB<string> KnobAccessTrace(KNOB_MODE_WRITEONCE, "pintool",
+    "trace", "", "record the L1 access stream into this file for cacheReplay");
+KNOB<string> stats_json(KNOB_MODE_WRITEONCE, "pintool",
+    "statsjson", "", "also write the cache counters and derived metrics to this file as JSON");
+KNOB<string> stats_csv(KNOB_MODE_WRITEONCE, "pintool",
+    "statscsv", "", "also write the cache counters and derived metrics to this file as CSV (group,name,value)");
 
 KNOB<int> L1_cache_total_kb(KNOB_MODE_WRITEONCE, "pintool", "l1s", "64", "set L1 cache total size in KB");
 KNOB<int> L1_cache_block_b(KNOB_MODE_WRITEONCE, "pintool", "l1b", "64", "set L1 cache block size in Bytes");
@@ -77,7 +149,60 @@ KNOB<int> L2_cache_total_kb(KNOB_MODE_WRITEONCE, "pintool", "l2s", "1024", "set
 KNOB<int> L2_cache_block_b(KNOB_MODE_WRITEONCE, "pintool", "l2b", "64", "set L2 cache block size in Bytes");
 KNOB<int> L2_cache_assoc_w(KNOB_MODE_WRITEONCE, "pintool", "l2w", "16", "set L2 cache ways");
 
+KNOB<string> hier_file(KNOB_MODE_WRITEONCE, "pintool", "hier", "", "cache hierarchy file (see hierBuilder.h); overrides the l1*/l2*, repl, pfl* and latency knobs");
 KNOB<int> tcp_enable(KNOB_MODE_WRITEONCE, "pintool", "p", "false", "TCP Prefetcher Enable = 1 Disable= 0");
+KNOB<string> repl_policy(KNOB_MODE_WRITEONCE, "pintool", "repl", "lru", "replacement policy: lru, srrip, drrip, ship, dbp");
+KNOB<string> pf_l1d(KNOB_MODE_WRITEONCE, "pintool", "pfl1", "", "L1-D prefetch engines: name[:degree[:distance]],... (stride, stream, nextline)");
+KNOB<string> pf_l2(KNOB_MODE_WRITEONCE, "pintool", "pfl2", "", "L2 prefetch engines: name[:degree[:distance]],... (stride, stream, nextline)");
+KNOB<int> pf_delay(KNOB_MODE_WRITEONCE, "pintool", "pfdelay", "8", "prefetch fill latency in accesses to the prefetching cache");
+
+KNOB<int> timing_enable(KNOB_MODE_WRITEONCE, "pintool", "timing", "0", "latency/MSHR timing model Enable = 1 Disable = 0");
+KNOB<int> l1_latency(KNOB_MODE_WRITEONCE, "pintool", "l1lat", "4", "L1 hit latency in cycles");
+KNOB<int> l2_latency(KNOB_MODE_WRITEONCE, "pintool", "l2lat", "12", "L2 hit latency in cycles");
+KNOB<int> mem_latency(KNOB_MODE_WRITEONCE, "pintool", "memlat", "200", "memory latency in cycles");
+KNOB<int> l1_mshrs(KNOB_MODE_WRITEONCE, "pintool", "l1mshr", "8", "MSHRs per L1 cache");
+KNOB<int> l2_mshrs(KNOB_MODE_WRITEONCE, "pintool", "l2mshr", "16", "L2 MSHRs");
+
+KNOB<int> mt_enable(KNOB_MODE_WRITEONCE, "pintool", "mt", "0", "per-thread private L1s with a coherent shared L2 Enable = 1 Disable = 0");
+KNOB<int> llc_stripes(KNOB_MODE_WRITEONCE, "pintool", "llcstripes", "16", "lock stripes of the shared L2 and directory (-mt)");
+
+KNOB<int> wbb_entries(KNOB_MODE_WRITEONCE, "pintool", "wbb", "0", "coalescing write-back buffer entries of the L1-D and the L2 (0: none)");
+KNOB<int> vc_entries(KNOB_MODE_WRITEONCE, "pintool", "vc", "0", "victim cache entries of the L1-D (0: none)");
+KNOB<int> wb_train(KNOB_MODE_WRITEONCE, "pintool", "wbtrain", "1", "write-backs train DBP/TCP, the prefetch engines and the replacement policy and count as misses = 1, update tags/recency only = 0");
+
+KNOB<int> tlb_enable(KNOB_MODE_WRITEONCE, "pintool", "tlb", "0", "TLBs, page walks and first-touch physical addresses Enable = 1 Disable = 0");
+KNOB<int> itlb_entries(KNOB_MODE_WRITEONCE, "pintool", "itlbe", "128", "L1 I-TLB entries");
+KNOB<int> itlb_ways(KNOB_MODE_WRITEONCE, "pintool", "itlbw", "8", "L1 I-TLB ways");
+KNOB<int> dtlb_entries(KNOB_MODE_WRITEONCE, "pintool", "dtlbe", "64", "L1 D-TLB entries");
+KNOB<int> dtlb_ways(KNOB_MODE_WRITEONCE, "pintool", "dtlbw", "4", "L1 D-TLB ways");
+KNOB<int> stlb_entries(KNOB_MODE_WRITEONCE, "pintool", "stlbe", "1536", "L2 TLB entries");
+KNOB<int> stlb_ways(KNOB_MODE_WRITEONCE, "pintool", "stlbw", "12", "L2 TLB ways");
+KNOB<int> pwc_entries(KNOB_MODE_WRITEONCE, "pintool", "pwc", "32", "page-walk cache entries (0: none)");
+KNOB<int> phys_mb(KNOB_MODE_WRITEONCE, "pintool", "physmb", "4096", "physical memory in MB (power of 2)");
+KNOB<int> thp_enable(KNOB_MODE_WRITEONCE, "pintool", "thp", "0", "map data with 2MB pages Enable = 1 Disable = 0");
+
+KNOB<UINT64> roi_skip(KNOB_MODE_WRITEONCE, "pintool", "skip", "0", "fast-forward this many instructions (after the ROI begin marker/routine, if any) before simulating");
+KNOB<UINT64> roi_simlen(KNOB_MODE_WRITEONCE, "pintool", "simlen", "0", "end the ROI after simulating this many instructions (0: no limit)");
+KNOB<int> roi_magic(KNOB_MODE_WRITEONCE, "pintool", "roimagic", "0", "xchg %rcx,%rcx begins and xchg %rdx,%rdx ends the ROI Enable = 1 Disable = 0");
+KNOB<string> roi_rtn(KNOB_MODE_WRITEONCE, "pintool", "roirtn", "", "the ROI is every execution of this routine (entry to exit)");
+KNOB<int> roi_detach(KNOB_MODE_WRITEONCE, "pintool", "roidetach", "1", "at the end of the ROI: write the report and detach = 1, continue (until the next ROI with markers) = 0");
+
+KNOB<UINT64> interval_len(KNOB_MODE_WRITEONCE, "pintool", "interval", "0", "write per-level counters every N instructions (0: off)");
+KNOB<string> interval_file(KNOB_MODE_WRITEONCE, "pintool", "intervalfile", "dbpSim_intervals.csv.gz", "interval statistics file (CSV, gzip)");
+KNOB<int> bbv_enable(KNOB_MODE_WRITEONCE, "pintool", "bbv", "0", "basic-block vector of every interval (SimPoint .bb format) Enable = 1 Disable = 0");
+KNOB<string> bbv_file(KNOB_MODE_WRITEONCE, "pintool", "bbvfile", "dbpSim.bb.gz", "basic-block vector file (gzip)");
+
+KNOB<int> sample_enable(KNOB_MODE_WRITEONCE, "pintool", "sample", "0", "SMARTS-style sampling Enable = 1 Disable = 0");
+KNOB<INT64> sample_period(KNOB_MODE_WRITEONCE, "pintool", "smpperiod", "10000000", "sampling period in instructions");
+KNOB<INT64> sample_unit(KNOB_MODE_WRITEONCE, "pintool", "smpunit", "100000", "measured instructions per period");
+KNOB<INT64> sample_warm(KNOB_MODE_WRITEONCE, "pintool", "smpwarm", "500000", "detailed warming instructions before each unit");
+KNOB<int> sample_fw(KNOB_MODE_WRITEONCE, "pintool", "smpfw", "1", "functional warming between units = 1, skip = 0");
+KNOB<int> sample_conf(KNOB_MODE_WRITEONCE, "pintool", "smpconf", "95", "confidence level of the sampled estimates: 90, 95 or 99");
+
+KNOB<int> mrc_enable(KNOB_MODE_WRITEONCE, "pintool", "mrc", "0", "LRU miss-ratio curves for all cache sizes Enable = 1 Disable = 0");
+KNOB<int> mrc_l1_kb(KNOB_MODE_WRITEONCE, "pintool", "mrcl1", "1024", "largest L1 cache size in KB covered by the MRCs");
+KNOB<int> mrc_l2_kb(KNOB_MODE_WRITEONCE, "pintool", "mrcl2", "32768", "largest L2 cache size in KB covered by the MRCs");
+KNOB<int> mrc_ways(KNOB_MODE_WRITEONCE, "pintool", "mrcw", "16", "largest associativity covered by the MRCs");
 
 /* ===================================================================== */
 /* Print Help Message                                                    */
@@ -94,10 +219,25 @@ static INT32 Usage()
     return -1;
 }
 
+//virtual -> physical address; a page walk stalls the core
+static inline size_t Translate(size_t addr, size_t pc, bool ifetch)
+{
+    if (!Mmu)
+      return addr;
+    addr = Mmu->translate(addr, pc, ifetch);
+    if (Timing)
+      Timing->stall(Mmu->walk_latency);
+    return addr;
+}
+
 //L2 Data Cache Access - Read 
 static VOID RecordMemRead(VOID * ip, VOID * addr)
 {
-    L1_D_CACHE->access((size_t)addr, (size_t)ip, false);
+    L1_D_CACHE->access(Translate((size_t)addr, (size_t)ip, false), (size_t)ip, false);
+    if (Timing)
+      Timing->stall(L1_D_CACHE->last_latency - L1_D_CACHE->tm.hit_latency);
+    if (AccessTrace.is_open())
+      AccessTrace.record((size_t)addr, (size_t)ip, TR_READ);
 #ifdef _DEBUG_
     TraceFile << "@ " << dec << instCount << ", " << hex << ip << ": " << addr << " READ\n" ;
 #endif
@@ -112,7 +252,9 @@ static VOID RecordWriteAddr(VOID * addr)
 //L2 Data Cache Access - Write 
 static VOID RecordMemWrite(VOID * ip)
 {
-    L1_D_CACHE->access((size_t)WriteAddr, (size_t)ip, true);
+    L1_D_CACHE->access(Translate((size_t)WriteAddr, (size_t)ip, false), (size_t)ip, true);
+    if (AccessTrace.is_open())
+      AccessTrace.record((size_t)WriteAddr, (size_t)ip, TR_WRITE);
 #ifdef _DEBUG_
     TraceFile << "@ " << dec << instCount << ", " << hex << ip << ": " << WriteAddr << " WRITE\n" ;
 #endif
@@ -121,12 +263,381 @@ static VOID RecordMemWrite(VOID * ip)
 //L1 Instruction Cache Access 
 VOID countFunc(VOID * ip)
 {
-  L1_I_CACHE->access((size_t)ip, (size_t)ip, false);
+  if (Timing)
+    Timing->tick_instr();
+  L1_I_CACHE->access(Translate((size_t)ip, (size_t)ip, true), (size_t)ip, false);
+  if (Timing)
+    Timing->stall(L1_I_CACHE->last_latency - L1_I_CACHE->tm.hit_latency);
+  if (AccessTrace.is_open())
+    AccessTrace.record((size_t)ip, (size_t)ip, TR_IFETCH);
   instCount++;
 }
 
+/* ===================================================================== */
+/* Region of interest                                                    */
+/* ===================================================================== */
+
+//Outside the ROI only the (inlined) skip/length counters and the begin markers are
+//instrumented. Every state change calls PIN_RemoveInstrumentation, so all code is
+//re-instrumented for the new state; the trace running at the switch finishes the old way.
+
+static BOOL RoiUsesMarkers()
+{
+    return roi_magic.Value() || !roi_rtn.Value().empty();
+}
+
+static VOID SetRoiState(roiState state)
+{
+    RoiState = state;
+    if (state == ROI_SKIP)
+      RoiLeft = (INT64) roi_skip.Value();
+    else if (state == ROI_SIM)
+    {
+      RoiLeft = (INT64) roi_simlen.Value();
+      RoiCount++;
+    }
+    PIN_RemoveInstrumentation();
+}
+
+//a begin marker or routine entry
+static VOID RoiBegin()
+{
+    if (RoiState == ROI_WAIT)
+      SetRoiState(roi_skip.Value() ? ROI_SKIP : ROI_SIM);
+}
+
+//an end marker, routine exit or -simlen reached
+static VOID RoiEnd()
+{
+    if (RoiState != ROI_SIM && RoiState != ROI_SKIP)
+      return;
+    if (roi_detach.Value())
+    {
+      //the report is written by the detach callback
+      if (!RoiDetaching)
+      {
+        RoiDetaching = true;
+        RoiState = ROI_DONE;
+        PIN_Detach();
+      }
+      return;
+    }
+    SetRoiState(RoiUsesMarkers() ? ROI_WAIT : ROI_DONE);
+}
+
+static ADDRINT SkipTick(UINT32 n)
+{
+    RoiSkipped += n;
+    RoiLeft -= n;
+    return (RoiLeft <= 0);
+}
+
+static VOID SkipDone()
+{
+    if (RoiState == ROI_SKIP)
+      SetRoiState(ROI_SIM);
+}
+
+static ADDRINT SimTick(UINT32 n)
+{
+    RoiSimulated += n;
+    RoiLeft -= n;
+    return (roi_simlen.Value() && RoiLeft <= 0);
+}
+
+static VOID RoiRtnEntry()
+{
+    if (RoiRtnDepth++ == 0)
+      RoiBegin();
+}
+
+static VOID RoiRtnExit()
+{
+    if (RoiRtnDepth > 0 && --RoiRtnDepth == 0)
+      RoiEnd();
+}
+
+static BOOL IsMagic(INS ins, REG reg)
+{
+    return INS_IsXchg(ins) && INS_OperandIsReg(ins, 0) && INS_OperandIsReg(ins, 1)
+           && INS_OperandReg(ins, 0) == reg && INS_OperandReg(ins, 1) == reg;
+}
+
+//per-BBL instruction counters and magic markers of the current ROI state
+static VOID RoiTrace(TRACE trace, VOID * v)
+{
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+      if (RoiState == ROI_SKIP)
+      {
+        BBL_InsertIfCall(bbl, IPOINT_BEFORE, (AFUNPTR)SkipTick, IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+        BBL_InsertThenCall(bbl, IPOINT_BEFORE, (AFUNPTR)SkipDone, IARG_END);
+      }
+      else if (RoiState == ROI_SIM)
+      {
+        BBL_InsertIfCall(bbl, IPOINT_BEFORE, (AFUNPTR)SimTick, IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+        BBL_InsertThenCall(bbl, IPOINT_BEFORE, (AFUNPTR)RoiEnd, IARG_END);
+      }
+
+      if (!roi_magic.Value())
+        continue;
+      for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+      {
+        if (RoiState == ROI_WAIT && IsMagic(ins, REG_GCX))
+          INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RoiBegin, IARG_END);
+        else if ((RoiState == ROI_SIM || RoiState == ROI_SKIP) && IsMagic(ins, REG_GDX))
+          INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RoiEnd, IARG_END);
+      }
+    }
+}
+
+//-roirtn: routine entry/exit (re-applied by Pin after PIN_RemoveInstrumentation)
+static VOID RoiRoutine(RTN rtn, VOID * v)
+{
+    if (RTN_Name(rtn) != roi_rtn.Value())
+      return;
+    RTN_Open(rtn);
+    RTN_InsertCall(rtn, IPOINT_BEFORE, (AFUNPTR)RoiRtnEntry, IARG_END);
+    RTN_InsertCall(rtn, IPOINT_AFTER, (AFUNPTR)RoiRtnExit, IARG_END);
+    RTN_Close(rtn);
+}
+
+/* ===================================================================== */
+/* -interval / -bbv                                                      */
+/* ===================================================================== */
+
+static ADDRINT IntervalTick(UINT32 n)
+{
+    IntervalInstrs += n;
+    IntervalLeft -= n;
+    return (IntervalLeft <= 0);
+}
+
+static VOID IntervalEnd()
+{
+    Intervals->end_interval(IntervalInstrs);
+    if (Bbv)
+      Bbv->end_interval();
+    IntervalInstrs = 0;
+    IntervalLeft += (INT64) interval_len.Value();
+}
+
+static VOID BbvCount(UINT32 id, UINT32 n)
+{
+    Bbv->count(id, n);
+}
+
+//instructions are counted per BBL, so an interval ends at the first BBL boundary past N
+static VOID IntervalTrace(TRACE trace, VOID * v)
+{
+    if (RoiState != ROI_SIM)
+      return;
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+      if (Bbv)
+      {
+        std::map<ADDRINT, UINT32>::iterator it = BblIds.find(BBL_Address(bbl));
+        if (it == BblIds.end())
+          it = BblIds.insert(std::make_pair(BBL_Address(bbl), Bbv->new_block())).first;
+        BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)BbvCount, IARG_UINT32, it->second, IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+      }
+      BBL_InsertIfCall(bbl, IPOINT_BEFORE, (AFUNPTR)IntervalTick, IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+      BBL_InsertThenCall(bbl, IPOINT_BEFORE, (AFUNPTR)IntervalEnd, IARG_END);
+    }
+}
+
+/* ===================================================================== */
+/* -sample analysis routines                                             */
+/* ===================================================================== */
+
+//the If-routines are inlined by Pin, so a skipped instruction only costs the counter
+//decrement and flag tests
+
+static ADDRINT PhaseTick()
+{
+    return (--PhaseLeft < 0);
+}
+
+static VOID PhaseEnd()
+{
+    PhaseLeft = Sampler->next_phase() - 1;
+    InDetailed = Sampler->detailed();
+    InWarming = !InDetailed && Sampler->functional_warming;
+}
+
+static ADDRINT IsDetailed()
+{
+    return InDetailed;
+}
+
+static ADDRINT IsWarming()
+{
+    return InWarming;
+}
+
+static ADDRINT IsSimulated()
+{
+    return InDetailed | InWarming;
+}
+
+static VOID WarmIFetch(VOID * ip)
+{
+    L1_I_CACHE->warm((size_t)ip, (size_t)ip, false);
+}
+
+static VOID WarmMemRead(VOID * ip, VOID * addr)
+{
+    L1_D_CACHE->warm((size_t)addr, (size_t)ip, false);
+}
+
+static VOID WarmMemWrite(VOID * ip)
+{
+    L1_D_CACHE->warm((size_t)WriteAddr, (size_t)ip, true);
+}
+
+static VOID InstructionSampled(INS ins)
+{
+    INS_InsertIfCall(ins, IPOINT_BEFORE, (AFUNPTR)PhaseTick, IARG_END);
+    INS_InsertThenCall(ins, IPOINT_BEFORE, (AFUNPTR)PhaseEnd, IARG_END);
+
+    INS_InsertIfCall(ins, IPOINT_BEFORE, (AFUNPTR)IsDetailed, IARG_END);
+    INS_InsertThenCall(ins, IPOINT_BEFORE, (AFUNPTR)countFunc, IARG_INST_PTR, IARG_END);
+    INS_InsertIfCall(ins, IPOINT_BEFORE, (AFUNPTR)IsWarming, IARG_END);
+    INS_InsertThenCall(ins, IPOINT_BEFORE, (AFUNPTR)WarmIFetch, IARG_INST_PTR, IARG_END);
+
+    UINT32 reads = (INS_IsMemoryRead(ins) ? 1 : 0) + (INS_HasMemoryRead2(ins) ? 1 : 0);
+    for (UINT32 r = 0; r < reads; r++)
+    {
+        IARG_TYPE ea = (r == 0 && INS_IsMemoryRead(ins)) ? IARG_MEMORYREAD_EA : IARG_MEMORYREAD2_EA;
+        INS_InsertIfPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)IsDetailed, IARG_END);
+        INS_InsertThenPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordMemRead, IARG_INST_PTR, ea, IARG_END);
+        INS_InsertIfPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)IsWarming, IARG_END);
+        INS_InsertThenPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)WarmMemRead, IARG_INST_PTR, ea, IARG_END);
+    }
+
+    if (INS_IsMemoryWrite(ins))
+    {
+        INS_InsertIfPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)IsSimulated, IARG_END);
+        INS_InsertThenPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordWriteAddr, IARG_MEMORYWRITE_EA, IARG_END);
+
+        IPOINT after[2] = { IPOINT_AFTER, IPOINT_TAKEN_BRANCH };
+        BOOL valid[2] = { INS_HasFallThrough(ins), INS_IsBranchOrCall(ins) };
+        for (int i = 0; i < 2; i++)
+        {
+            if (!valid[i])
+              continue;
+            INS_InsertIfCall(ins, after[i], (AFUNPTR)IsDetailed, IARG_END);
+            INS_InsertThenCall(ins, after[i], (AFUNPTR)RecordMemWrite, IARG_INST_PTR, IARG_END);
+            INS_InsertIfCall(ins, after[i], (AFUNPTR)IsWarming, IARG_END);
+            INS_InsertThenCall(ins, after[i], (AFUNPTR)WarmMemWrite, IARG_INST_PTR, IARG_END);
+        }
+    }
+}
+
+/* ===================================================================== */
+/* -mt analysis routines: every thread drives its own core               */
+/* ===================================================================== */
+
+static VOID ThreadStart(THREADID tid, CONTEXT * ctxt, INT32 flags, VOID * v)
+{
+    threadData * td = new threadData;
+    td->write_addr = 0;
+    td->core = MtSys ? MtSys->add_core(tid) : 0;
+    if (MtSys && !td->core)
+      __sync_fetch_and_add(&MtUnsimulated, 1);
+    PIN_SetThreadData(MtKey, td, tid);
+
+    if (__sync_add_and_fetch(&NumThreads, 1) == 2 && !MtSys)
+      cerr << "dbpSim: multi-threaded application; all threads share one L1 (use -mt 1 for private L1s)" << endl;
+}
+
+static VOID ThreadFini(THREADID tid, const CONTEXT * ctxt, INT32 code, VOID * v)
+{
+    delete static_cast<threadData *>(PIN_GetThreadData(MtKey, tid));
+}
+
+static VOID MtIFetch(THREADID tid, VOID * ip)
+{
+    threadData * td = static_cast<threadData *>(PIN_GetThreadData(MtKey, tid));
+    if (td->core)
+      MtSys->ifetch(td->core, (size_t)ip);
+}
+
+static VOID MtMemRead(THREADID tid, VOID * ip, VOID * addr)
+{
+    threadData * td = static_cast<threadData *>(PIN_GetThreadData(MtKey, tid));
+    if (td->core)
+      MtSys->read(td->core, (size_t)addr, (size_t)ip);
+}
+
+static VOID MtWriteAddr(THREADID tid, VOID * addr)
+{
+    static_cast<threadData *>(PIN_GetThreadData(MtKey, tid))->write_addr = addr;
+}
+
+static VOID MtMemWrite(THREADID tid, VOID * ip)
+{
+    threadData * td = static_cast<threadData *>(PIN_GetThreadData(MtKey, tid));
+    if (td->core)
+      MtSys->write(td->core, (size_t)td->write_addr, (size_t)ip);
+}
+
+static VOID InstructionMt(INS ins)
+{
+    INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)MtIFetch, IARG_THREAD_ID, IARG_INST_PTR, IARG_END);
+
+    if (INS_IsMemoryRead(ins))
+    {
+        INS_InsertPredicatedCall(
+            ins, IPOINT_BEFORE, (AFUNPTR)MtMemRead,
+            IARG_THREAD_ID, IARG_INST_PTR, IARG_MEMORYREAD_EA,
+            IARG_END);
+    }
+    if (INS_HasMemoryRead2(ins))
+    {
+        INS_InsertPredicatedCall(
+            ins, IPOINT_BEFORE, (AFUNPTR)MtMemRead,
+            IARG_THREAD_ID, IARG_INST_PTR, IARG_MEMORYREAD2_EA,
+            IARG_END);
+    }
+    if (INS_IsMemoryWrite(ins))
+    {
+        INS_InsertPredicatedCall(
+            ins, IPOINT_BEFORE, (AFUNPTR)MtWriteAddr,
+            IARG_THREAD_ID, IARG_MEMORYWRITE_EA,
+            IARG_END);
+        if (INS_HasFallThrough(ins))
+        {
+            INS_InsertCall(
+                ins, IPOINT_AFTER, (AFUNPTR)MtMemWrite,
+                IARG_THREAD_ID, IARG_INST_PTR,
+                IARG_END);
+        }
+        if (INS_IsBranchOrCall(ins))
+        {
+            INS_InsertCall(
+                ins, IPOINT_TAKEN_BRANCH, (AFUNPTR)MtMemWrite,
+                IARG_THREAD_ID, IARG_INST_PTR,
+                IARG_END);
+        }
+    }
+}
+
 VOID Instruction(INS ins, VOID *v)
 {
+    if (RoiState != ROI_SIM)
+      return;
+    if (MtSys)
+    {
+        InstructionMt(ins);
+        return;
+    }
+    if (Sampler)
+    {
+        InstructionSampled(ins);
+        return;
+    }
+
     INS_InsertCall(ins,IPOINT_BEFORE,(AFUNPTR)countFunc, IARG_INST_PTR, IARG_END);
 
     // instruments loads using a predicated call, i.e.
@@ -173,11 +684,10 @@ VOID Instruction(INS ins, VOID *v)
 
 /* ===================================================================== */
 
-VOID Fini(INT32 code, VOID *v)
+//stats of the built-in L1-I/L1-D/L2 hierarchy
+static VOID ReportFixedHierarchy()
 {
-    TraceFile << "\ndbpSim: Cache Statistics : " << std::endl;
-    TraceFile << "==============================================" << std::endl;
-    TraceFile << std::dec;
+    TraceFile << "Replacement Policy: " << repl_policy.Value() << std::endl;
 
     TraceFile << "\nL1 Instruction Cache Stats: " << std::endl;
     TraceFile << "Cache Size (KB): " << L1_cache_total_kb.Value() << std::endl;
@@ -188,12 +698,15 @@ VOID Fini(INT32 code, VOID *v)
     TraceFile << "L1 I_CACHE DEAD BLK PRED: " << L1_I_CACHE->get_dbp_cnt() << std::endl;
     TraceFile << "L1 I_CACHE EVICTIONS: " << L1_I_CACHE->get_evicted_cnt() << std::endl;
     TraceFile << "L1 I_CACHE DBP MISS_PRED: " << L1_I_CACHE->get_dbp_miss_pred() << std::endl;
-    double l1i_accuracy = (double)(L1_I_CACHE->get_dbp_cnt() - L1_I_CACHE->get_dbp_miss_pred()) / (double) (L1_I_CACHE->get_dbp_cnt());
-    TraceFile << "L1 I_CACHE DBP ACCURACY : " << l1i_accuracy << std::endl;
-    double l1i_cov = (double)(L1_I_CACHE->get_dbp_cnt() - L1_I_CACHE->get_dbp_miss_pred()) / (double) (L1_I_CACHE->get_evicted_cnt());
-    TraceFile << "L1 I_CACHE DBP COVERAGE : " << l1i_cov << std::endl;
+    cacheMetrics l1i = L1_I_CACHE->metrics(instCount);
+    TraceFile << "L1 I_CACHE DBP ACCURACY : " << l1i.dbp_accuracy << std::endl;
+    TraceFile << "L1 I_CACHE DBP COVERAGE : " << l1i.dbp_coverage << std::endl;
     TraceFile << "L1 I_CACHE TCP Prefetches: " << L1_I_CACHE->get_tcp_pr_cnt() << std::endl;
     TraceFile << "L1 I_CACHE TCP Useless Prefetches: " << L1_I_CACHE->get_useless_pr_cnt() << std::endl;
+    TraceFile << "L1 I_CACHE BYPASSED FILLS: " << L1_I_CACHE->get_bypass_cnt() << std::endl;
+#ifdef BLK_LIFETIME_STATS
+    L1_I_CACHE->report_lifetimes(TraceFile, "L1 I_CACHE");
+#endif
 
     TraceFile << "\nL1 Data Cache Stats: " << std::endl;
     TraceFile << "Cache Size (KB): " << L1_cache_total_kb.Value() << std::endl;
@@ -204,12 +717,23 @@ VOID Fini(INT32 code, VOID *v)
     TraceFile << "L1 D_CACHE DEAD BLK PRED: " << L1_D_CACHE->get_dbp_cnt() << std::endl;
     TraceFile << "L1 D_CACHE EVICTIONS: " << L1_D_CACHE->get_evicted_cnt() << std::endl;
     TraceFile << "L1 D_CACHE DBP MISS_PRED: " << L1_D_CACHE->get_dbp_miss_pred() << std::endl;
-    double l1d_accuracy = (double)(L1_D_CACHE->get_dbp_cnt() - L1_D_CACHE->get_dbp_miss_pred()) / (double) (L1_D_CACHE->get_dbp_cnt());
-    TraceFile << "L1 D_CACHE DBP ACCURACY : " << l1d_accuracy << std::endl;
-    double l1d_cov = (double)(L1_D_CACHE->get_dbp_cnt() - L1_D_CACHE->get_dbp_miss_pred()) / (double) (L1_D_CACHE->get_evicted_cnt());
-    TraceFile << "L1 D_CACHE DBP COVERAGE : " << l1d_cov << std::endl;
+    cacheMetrics l1d = L1_D_CACHE->metrics(instCount);
+    TraceFile << "L1 D_CACHE DBP ACCURACY : " << l1d.dbp_accuracy << std::endl;
+    TraceFile << "L1 D_CACHE DBP COVERAGE : " << l1d.dbp_coverage << std::endl;
     TraceFile << "L1 D_CACHE TCP Prefetches: " << L1_D_CACHE->get_tcp_pr_cnt() << std::endl;
     TraceFile << "L1 D_CACHE TCP Useless Prefetches: " << L1_D_CACHE->get_useless_pr_cnt() << std::endl;
+    TraceFile << "L1 D_CACHE BYPASSED FILLS: " << L1_D_CACHE->get_bypass_cnt() << std::endl;
+    TraceFile << "L1 D_CACHE WRITE-BACKS RECEIVED: " << L1_D_CACHE->get_wb_cnt() << std::endl;
+    TraceFile << "L1 D_CACHE WRITE-BACK FILLS: " << L1_D_CACHE->get_wb_fill_cnt() << std::endl;
+    if (L1_D_CACHE->wbb)
+      L1_D_CACHE->wbb->report(TraceFile, "L1 D_CACHE");
+    if (L1_D_CACHE->vc)
+      L1_D_CACHE->vc->report(TraceFile, "L1 D_CACHE");
+    for (size_t i = 0; i < L1_D_CACHE->get_prefetchers().size(); i++)
+      L1_D_CACHE->get_prefetchers()[i]->report(TraceFile, "L1 D_CACHE", L1_D_CACHE->get_miss_cnt());
+#ifdef BLK_LIFETIME_STATS
+    L1_D_CACHE->report_lifetimes(TraceFile, "L1 D_CACHE");
+#endif
 
     TraceFile << "\nL2 Instruction/Data Cache Stats: " << std::endl;
     TraceFile << "Cache Size (KB): " << L2_cache_total_kb.Value() << std::endl;
@@ -221,32 +745,309 @@ VOID Fini(INT32 code, VOID *v)
     TraceFile << "L2 CACHE DEAD BLK PRED: " << L2_CACHE->get_dbp_cnt() << std::endl;
     TraceFile << "L2 CACHE EVICTIONS: " << L2_CACHE->get_evicted_cnt() << std::endl;
     TraceFile << "L2 CACHE DBP MISS_PRED: " << L2_CACHE->get_dbp_miss_pred() << std::endl;
-    double l2_accuracy = (double)(L2_CACHE->get_dbp_cnt() - L2_CACHE->get_dbp_miss_pred()) / (double) (L2_CACHE->get_dbp_cnt());
-    double l2_cov = (double)(L2_CACHE->get_dbp_cnt() - L2_CACHE->get_dbp_miss_pred()) / (double) (L2_CACHE->get_evicted_cnt());
-    TraceFile << "L2 CACHE DBP ACCURACY : " << l2_accuracy << std::endl;
-    TraceFile << "L2 CACHE DBP COVERAGE : " << l2_cov << std::endl;
+    cacheMetrics l2 = L2_CACHE->metrics(instCount);
+    TraceFile << "L2 CACHE DBP ACCURACY : " << l2.dbp_accuracy << std::endl;
+    TraceFile << "L2 CACHE DBP COVERAGE : " << l2.dbp_coverage << std::endl;
 
     TraceFile << "L2 CACHE TCP Prefetches: " << L2_CACHE->get_tcp_pr_cnt() << std::endl;
     TraceFile << "L2 CACHE TCP Useless Prefetches: " << L2_CACHE->get_useless_pr_cnt() << std::endl;
+    TraceFile << "L2 CACHE BYPASSED FILLS: " << L2_CACHE->get_bypass_cnt() << std::endl;
+    TraceFile << "L2 CACHE WRITE-BACKS RECEIVED: " << L2_CACHE->get_wb_cnt() << std::endl;
+    TraceFile << "L2 CACHE WRITE-BACK FILLS: " << L2_CACHE->get_wb_fill_cnt() << std::endl;
+    if (L2_CACHE->wbb)
+      L2_CACHE->wbb->report(TraceFile, "L2 CACHE");
+    if (L2_CACHE->vc)
+      L2_CACHE->vc->report(TraceFile, "L2 CACHE");
+    for (size_t i = 0; i < L2_CACHE->get_prefetchers().size(); i++)
+      L2_CACHE->get_prefetchers()[i]->report(TraceFile, "L2 CACHE", L2_CACHE->get_miss_cnt());
+#ifdef BLK_LIFETIME_STATS
+    L2_CACHE->report_lifetimes(TraceFile, "L2 CACHE");
+#endif
+    TraceFile << "==============================================" << std::endl;
+
+    if (Timing)
+    {
+      TraceFile << "\nTiming Model (in-order core, CPI 1 without memory stalls): " << std::endl;
+      Timing->report(TraceFile);
+      L1_I_CACHE->tm.report(TraceFile, "L1 I_CACHE", L1_I_CACHE->get_access_cnt());
+      L1_D_CACHE->tm.report(TraceFile, "L1 D_CACHE", L1_D_CACHE->get_access_cnt());
+      L2_CACHE->tm.report(TraceFile, "L2 CACHE", L2_CACHE->get_access_cnt());
+      TraceFile << "==============================================" << std::endl;
+    }
+}
+
+//-statsjson / -statscsv: groups "run" and one per cache ("l1i", "l1d", "l2", or the -hier level names)
+static VOID WriteStats()
+{
+    //-mt does not count instructions centrally; every instruction fetch is one merged L1-I access
+    long instrs = MtSys ? L1_I_CACHE->get_access_cnt() : (long) instCount;
+
+    statsRegistry reg;
+    reg.add_counter("run", "instructions", instrs);
+    if (MtSys)
+      reg.add_counter("run", "threads", NumThreads);
+    if (Timing)
+    {
+      reg.add_counter("run", "cycles", Timing->cycle);
+      reg.add_counter("run", "stall_cycles", Timing->stall_cycles);
+      reg.add_metric("run", "ipc", safe_ratio((double) Timing->instrs, (double) Timing->cycle));
+    }
+
+    if (Hier)
+    {
+      for (size_t i = 0; i < Hier->num_levels(); i++)
+        Hier->level(i)->register_stats(reg, Hier->config(i).name, instrs);
+    }
+    else
+    {
+      L1_I_CACHE->register_stats(reg, "l1i", instrs);
+      L1_D_CACHE->register_stats(reg, "l1d", instrs);
+      L2_CACHE->register_stats(reg, "l2", instrs);
+    }
+
+    if (!stats_json.Value().empty())
+    {
+      std::ofstream out(stats_json.Value().c_str());
+      reg.write_json(out);
+      if (!out)
+        cerr << "dbpSim: cannot write " << stats_json.Value() << endl;
+    }
+    if (!stats_csv.Value().empty())
+    {
+      std::ofstream out(stats_csv.Value().c_str());
+      reg.write_csv(out);
+      if (!out)
+        cerr << "dbpSim: cannot write " << stats_csv.Value() << endl;
+    }
+}
+
+VOID Fini(INT32 code, VOID *v)
+{
+    //write-backs still queued in the buffers reach the next level before reporting
+    if (Hier)
+      Hier->drain_write_backs();
+    else if (!MtSys)
+    {
+      L1_D_CACHE->drain_write_backs();
+      if (L2_CACHE)
+        L2_CACHE->drain_write_backs();
+    }
+
+    TraceFile << "\ndbpSim: Cache Statistics : " << std::endl;
     TraceFile << "==============================================" << std::endl;
+    TraceFile << std::dec;
 
-    delete L2_CACHE;
-    delete L1_I_CACHE;
-    delete L1_D_CACHE;
+    if (RoiUsesMarkers() || roi_skip.Value() || roi_simlen.Value())
+    {
+      TraceFile << "ROI: " << RoiCount << " region(s), " << RoiSkipped << " instructions fast-forwarded, "
+                << RoiSimulated << " instructions simulated" << (RoiDetaching ? " (detached)" : "") << std::endl;
+    }
+
+    if (Hier)
+    {
+      TraceFile << "Hierarchy: " << hier_file.Value() << std::endl;
+      Hier->report(TraceFile);
+      TraceFile << "==============================================" << std::endl;
+    }
+    else if (MtSys)
+    {
+      //aggregate over all threads, then per-thread and coherence counters
+      L1_I_CACHE = new cacheSim(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(), 0);
+      L1_D_CACHE = new cacheSim(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(), 0);
+      L2_CACHE = new cacheSim(L2_cache_total_kb.Value(), L2_cache_block_b.Value(), L2_cache_assoc_w.Value(), 0);
+      MtSys->merge_stats(*L1_I_CACHE, *L1_D_CACHE, *L2_CACHE);
+      TraceFile << "Threads: " << NumThreads << " (cache counters below are summed over all threads)" << std::endl;
+      ReportFixedHierarchy();
+
+      TraceFile << "\nPer-thread and Coherence Stats (MSI directory, " << llc_stripes.Value() << " L2 stripes): " << std::endl;
+      MtSys->report(TraceFile);
+      if (MtUnsimulated)
+        TraceFile << "THREADS NOT SIMULATED (id >= " << MAX_CORES << "): " << MtUnsimulated << std::endl;
+      TraceFile << "==============================================" << std::endl;
+    }
+    else
+    {
+      ReportFixedHierarchy();
+    }
+
+    if (!stats_json.Value().empty() || !stats_csv.Value().empty())
+      WriteStats();
+    delete MtSys;
+    MtSys = 0;
+
+    if (Mmu)
+    {
+      TraceFile << "\nTLB and Page Walk Stats (" << (thp_enable.Value() ? "2MB data pages" : "4KB pages") << "): " << std::endl;
+      Mmu->report(TraceFile, instCount);
+      TraceFile << "==============================================" << std::endl;
+      delete Mmu;
+    }
+
+    if (Intervals)
+    {
+      //the last, partial interval
+      if (IntervalInstrs)
+        IntervalEnd();
+      TraceFile << "Intervals: " << interval_file.Value() << (Bbv ? ", basic-block vectors: " + bbv_file.Value() : "") << std::endl;
+      delete Intervals;
+      delete Bbv;
+      Intervals = 0;
+      IntervalFile.close();
+      if (Bbv)
+        BbvFile.close();
+    }
+
+    if (Sampler)
+    {
+      Sampler->finish(PhaseLeft);
+      TraceFile << "\nSampled Estimates (counters above cover the detailed phases only): " << std::endl;
+      Sampler->report(TraceFile, sample_conf.Value());
+      TraceFile << "==============================================" << std::endl;
+      delete Sampler;
+    }
+
+    if (mrc_enable.Value())
+    {
+      TraceFile << "\nLRU Miss Ratio Curves (Stack Distance): " << std::endl;
+      L1_I_MRC->report(TraceFile, "L1 I_CACHE");
+      L1_D_MRC->report(TraceFile, "L1 D_CACHE");
+      if (L2_MRC)
+        L2_MRC->report(TraceFile, "L2 CACHE");
+      TraceFile << "==============================================" << std::endl;
+
+      delete L2_MRC;
+      delete L1_I_MRC;
+      delete L1_D_MRC;
+    }
+
+    if (Hier)
+    {
+      delete Hier;
+    }
+    else
+    {
+      delete L2_CACHE;
+      delete L1_I_CACHE;
+      delete L1_D_CACHE;
+      delete Timing;
+    }
 
     TraceFile << "#eof" << endl;
     TraceFile.close();
+
+    if (AccessTrace.is_open())
+    {
+      AccessTrace.flush();
+      AccessTraceFile.close();
+    }
+}
+
+//PIN_Detach (end of the ROI): Fini is not called after a detach
+static VOID Detached(VOID * v)
+{
+    Fini(0, v);
 }
 
 /* ===================================================================== */
 /* Main                                                                  */
 /* ===================================================================== */
 
+//-mt: per-thread L1s (l1* knobs, -pfl1) over a striped shared L2 (l2* knobs)
+static bool BuildCoherentSystem()
+{
+    replKind repl = parse_repl(repl_policy.Value());
+    if (repl == NUM_REPL)
+    {
+        cerr << "dbpSim: unknown replacement policy " << repl_policy.Value() << endl;
+        return false;
+    }
+    //every L2 stripe would train a private copy of the policy state
+    if (repl_shares_state(repl))
+    {
+        cerr << "dbpSim: -repl drrip, ship and dbp cannot be combined with -mt" << endl;
+        return false;
+    }
+    if (!hier_file.Value().empty() || timing_enable.Value() || mrc_enable.Value() || !KnobAccessTrace.Value().empty()
+        || !pf_l2.Value().empty())
+    {
+        cerr << "dbpSim: -mt cannot be combined with -hier, -timing, -mrc, -trace or -pfl2" << endl;
+        return false;
+    }
+    std::vector<prefetcher *> check;
+    if (!parse_prefetchers(pf_l1d.Value(), check))
+    {
+        cerr << "dbpSim: bad prefetcher list" << endl;
+        return false;
+    }
+    for (size_t i = 0; i < check.size(); i++)
+      delete check[i];
+
+    MtSys = new coherentSystem(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(),
+                               L2_cache_total_kb.Value(), L2_cache_block_b.Value(), L2_cache_assoc_w.Value(),
+                               llc_stripes.Value(), repl, pf_l1d.Value());
+    MtSys->pf_fill_delay = pf_delay.Value();
+    return true;
+}
+
+//L1-I and L1-D feeding one L2, configured by the l1*/l2* knobs
+static bool BuildFixedHierarchy()
+{
+    replKind repl = parse_repl(repl_policy.Value());
+    if (repl == NUM_REPL)
+    {
+        cerr << "dbpSim: unknown replacement policy " << repl_policy.Value() << endl;
+        return false;
+    }
+    L2_CACHE = new cacheSim(L2_cache_total_kb.Value(), L2_cache_block_b.Value(), L2_cache_assoc_w.Value(), 0); 
+    L2_CACHE->dbp_use_refcount = true; 
+    L1_I_CACHE = new cacheSim(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(), L2_CACHE); 
+    L1_D_CACHE = new cacheSim(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(), L2_CACHE); 
+    L2_CACHE->repl = repl;
+    L1_I_CACHE->repl = repl;
+    L1_D_CACHE->repl = repl;
+
+    std::vector<prefetcher *> l1_engines, l2_engines;
+    if (!parse_prefetchers(pf_l1d.Value(), l1_engines) || !parse_prefetchers(pf_l2.Value(), l2_engines))
+    {
+        cerr << "dbpSim: bad prefetcher list" << endl;
+        return false;
+    }
+    for (size_t i = 0; i < l1_engines.size(); i++)
+      L1_D_CACHE->add_prefetcher(l1_engines[i]);
+    for (size_t i = 0; i < l2_engines.size(); i++)
+      L2_CACHE->add_prefetcher(l2_engines[i]);
+    L1_D_CACHE->pf_fill_delay = pf_delay.Value();
+    L2_CACHE->pf_fill_delay = pf_delay.Value();
+
+    if (wbb_entries.Value())
+    {
+      L1_D_CACHE->wbb = new wbBuffer(wbb_entries.Value());
+      L2_CACHE->wbb = new wbBuffer(wbb_entries.Value());
+    }
+    if (vc_entries.Value())
+      L1_D_CACHE->vc = new victimCache(vc_entries.Value());
+    L2_CACHE->wb_train = (wb_train.Value() != 0);
+
+    if (timing_enable.Value())
+    {
+      Timing = new timingModel(mem_latency.Value());
+      cacheSim * caches[3] = { L1_I_CACHE, L1_D_CACHE, L2_CACHE };
+      for (int i = 0; i < 3; i++)
+      {
+        caches[i]->timing = Timing;
+        caches[i]->tm.hit_latency = (caches[i] == L2_CACHE) ? l2_latency.Value() : l1_latency.Value();
+        caches[i]->tm.mshrs = (caches[i] == L2_CACHE) ? l2_mshrs.Value() : l1_mshrs.Value();
+      }
+    }
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     string trace_header = string("#\n"
                                  "# Memory Access Trace Generated By Pin\n"
                                  "#\n");
+    PIN_InitSymbols();
     if( PIN_Init(argc,argv) )
     {
         return Usage();
@@ -255,6 +1056,12 @@ int main(int argc, char *argv[])
     TraceFile.write(trace_header.c_str(),trace_header.size());
     TraceFile.setf(ios::showbase);
 
+    if (!KnobAccessTrace.Value().empty())
+    {
+      AccessTraceFile.open(KnobAccessTrace.Value().c_str());
+      AccessTrace.open(&AccessTraceFile);
+    }
+
     std::cout << "\ndbpSim: Cache Configuration : " << std::endl;
     std::cout << "==============================================" << std::endl;
     std::cout << "L1 Cache Size (KB): " << L1_cache_total_kb.Value() << std::endl;
@@ -264,14 +1071,164 @@ int main(int argc, char *argv[])
     std::cout << "L2 Cache Size (KB): " << L2_cache_total_kb.Value() << std::endl;
     std::cout << "L2 Block Size (B): " << L2_cache_block_b.Value() << std::endl;
     std::cout << "L2 Set Ways : " << L2_cache_assoc_w.Value() << std::endl;
+    std::cout << "Hierarchy File : " << hier_file.Value() << std::endl;
+    std::cout << "Replacement Policy : " << repl_policy.Value() << std::endl;
+    std::cout << "L1-D Prefetchers : " << pf_l1d.Value() << std::endl;
+    std::cout << "L2 Prefetchers : " << pf_l2.Value() << std::endl;
     std::cout << "==============================================\n" << std::endl;
 
     TcpEnabled = (tcp_enable.Value() == 0) ? false : true;
-    L2_CACHE = new cacheSim(L2_cache_total_kb.Value(), L2_cache_block_b.Value(), L2_cache_assoc_w.Value(), 0); 
-    L2_CACHE->dbp_use_refcount = true; 
-    L1_I_CACHE = new cacheSim(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(), L2_CACHE); 
-    L1_D_CACHE = new cacheSim(L1_cache_total_kb.Value(), L1_cache_block_b.Value(), L1_cache_assoc_w.Value(), L2_CACHE); 
+    MtKey = PIN_CreateThreadDataKey(0);
+    if (mt_enable.Value())
+    {
+      if (!BuildCoherentSystem())
+        return Usage();
+    }
+    else if (!hier_file.Value().empty())
+    {
+      std::string err;
+      Hier = new cacheHierarchy();
+      if (!Hier->load(hier_file.Value(), err))
+      {
+          cerr << "dbpSim: " << hier_file.Value() << ": " << err << endl;
+          return Usage();
+      }
+      L1_I_CACHE = Hier->icache;
+      L1_D_CACHE = Hier->dcache;
+      L2_CACHE = L1_D_CACHE->get_parent();
+      for (size_t i = 0; i < Hier->num_levels(); i++)
+        Hier->level(i)->wb_train = (wb_train.Value() != 0);
+      if (timing_enable.Value())
+        Timing = Hier->enable_timing();
+    }
+    else if (!BuildFixedHierarchy())
+    {
+      return Usage();
+    }
+
+    if ((wbb_entries.Value() || vc_entries.Value() || !wb_train.Value()) && MtSys)
+    {
+        cerr << "dbpSim: -wbb, -vc and -wbtrain cannot be combined with -mt" << endl;
+        return Usage();
+    }
+    if ((wbb_entries.Value() || vc_entries.Value()) && Hier)
+    {
+        cerr << "dbpSim: with -hier, use the wbb/vc keys of the hierarchy file instead of -wbb/-vc" << endl;
+        return Usage();
+    }
+    //the MRCs are sized from the -l1b/-l2b knobs and labelled L1/L2; a -hier file
+    //may use other block sizes, more levels or separate parents for the L1s
+    if (mrc_enable.Value() && Hier)
+    {
+        cerr << "dbpSim: -mrc cannot be combined with -hier" << endl;
+        return Usage();
+    }
+
+    if (tlb_enable.Value())
+    {
+      if (MtSys || sample_enable.Value())
+      {
+          cerr << "dbpSim: -tlb cannot be combined with -mt or -sample" << endl;
+          return Usage();
+      }
+      Mmu = new mmuSim(itlb_entries.Value(), itlb_ways.Value(), dtlb_entries.Value(), dtlb_ways.Value(),
+                       stlb_entries.Value(), stlb_ways.Value(), pwc_entries.Value(), phys_mb.Value(),
+                       thp_enable.Value() != 0);
+      Mmu->walk_cache = L2_CACHE;
+    }
+
+    if (sample_enable.Value())
+    {
+      if (mt_enable.Value() || Hier || Timing || mrc_enable.Value() || AccessTrace.is_open())
+      {
+          cerr << "dbpSim: -sample cannot be combined with -mt, -hier, -timing, -mrc or -trace" << endl;
+          return Usage();
+      }
+      Sampler = new smartsSampler(sample_period.Value(), sample_unit.Value(), sample_warm.Value());
+      if (!Sampler->valid())
+      {
+          cerr << "dbpSim: -sample needs smpunit > 0 and smpunit + smpwarm <= smpperiod" << endl;
+          return Usage();
+      }
+      Sampler->functional_warming = (sample_fw.Value() != 0);
+      Sampler->add_cache("L1 I_CACHE", L1_I_CACHE);
+      Sampler->add_cache("L1 D_CACHE", L1_D_CACHE);
+      Sampler->add_cache("L2 CACHE", L2_CACHE);
+      PhaseLeft = Sampler->get_phase_len();
+      InDetailed = Sampler->detailed();
+      InWarming = !InDetailed && Sampler->functional_warming;
+    }
+
+    if (interval_len.Value())
+    {
+      if (MtSys)
+      {
+          cerr << "dbpSim: -interval cannot be combined with -mt" << endl;
+          return Usage();
+      }
+      IntervalFile.open(interval_file.Value().c_str());
+      Intervals = new intervalRecorder(&IntervalFile);
+      if (Hier)
+      {
+        for (size_t i = 0; i < Hier->num_levels(); i++)
+          Intervals->add_cache(Hier->config(i).name, Hier->level(i));
+      }
+      else
+      {
+        Intervals->add_cache("l1i", L1_I_CACHE);
+        Intervals->add_cache("l1d", L1_D_CACHE);
+        Intervals->add_cache("l2", L2_CACHE);
+      }
+      if (bbv_enable.Value())
+      {
+        BbvFile.open(bbv_file.Value().c_str());
+        Bbv = new bbvProfile(&BbvFile);
+      }
+      IntervalLeft = (INT64) interval_len.Value();
+      TRACE_AddInstrumentFunction(IntervalTrace, 0);
+    }
+    else if (bbv_enable.Value())
+    {
+      cerr << "dbpSim: -bbv needs -interval" << endl;
+      return Usage();
+    }
+
+    //MRCs observe each level's own access stream (L2: L1 misses + write-backs)
+    if (mrc_enable.Value())
+    {
+      L1_I_MRC = new stackDistSim(L1_cache_block_b.Value(), mrc_l1_kb.Value(), mrc_ways.Value());
+      L1_D_MRC = new stackDistSim(L1_cache_block_b.Value(), mrc_l1_kb.Value(), mrc_ways.Value());
+      L1_I_CACHE->mrc = L1_I_MRC;
+      L1_D_CACHE->mrc = L1_D_MRC;
+      if (L2_CACHE)
+      {
+        L2_MRC = new stackDistSim(L2_cache_block_b.Value(), mrc_l2_kb.Value(), mrc_ways.Value());
+        L2_CACHE->mrc = L2_MRC;
+      }
+    }
+
+    if (RoiUsesMarkers() || roi_skip.Value() || roi_simlen.Value())
+    {
+      if (RoiUsesMarkers())
+        RoiState = ROI_WAIT;
+      else if (roi_skip.Value())
+      {
+        RoiState = ROI_SKIP;
+        RoiLeft = (INT64) roi_skip.Value();
+      }
+      else
+      {
+        RoiCount = 1;
+        RoiLeft = (INT64) roi_simlen.Value();
+      }
+      TRACE_AddInstrumentFunction(RoiTrace, 0);
+      if (!roi_rtn.Value().empty())
+        RTN_AddInstrumentFunction(RoiRoutine, 0);
+      PIN_AddDetachFunction(Detached, 0);
+    }
 
+    PIN_AddThreadStartFunction(ThreadStart, 0);
+    PIN_AddThreadFiniFunction(ThreadFini, 0);
     INS_AddInstrumentFunction(Instruction, 0);
     PIN_AddFiniFunction(Fini, 0);
 
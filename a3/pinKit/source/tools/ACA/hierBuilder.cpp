@@ -0,0 +1,376 @@
+#include "hierBuilder.h"
+#include "wbBuffer.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+levelConfig::levelConfig()
+ : role("none"), size_kb(32), block_b(64), ways(8), parent("memory"), tables("shared"), repl("lru"),
+   inclusion("nine"), latency(4), mshrs(8), wbb(0), vc(0), line(0)
+{
+}
+
+static std::string trim(const std::string & s)
+{
+  size_t b = s.find_first_not_of(" \t\r");
+  if (b == std::string::npos)
+    return "";
+  size_t e = s.find_last_not_of(" \t\r");
+  return s.substr(b, e - b + 1);
+}
+
+static bool to_int(const std::string & s, int & v)
+{
+  char * end;
+  long n = strtol(s.c_str(), &end, 10);
+  if (s.empty() || *end != '\0' || n <= 0)
+    return false;
+  v = (int) n;
+  return true;
+}
+
+static inline bool IS_POW_2(long num)
+{
+  return ((num & (num - 1)) == 0);
+}
+
+cacheHierarchy::cacheHierarchy() : timing(0), mem_latency(200), icache(0), dcache(0)
+{
+}
+
+cacheHierarchy::~cacheHierarchy()
+{
+  for (size_t i = 0; i < caches.size(); i++)
+    delete caches[i];
+  for (size_t i = 0; i < own_tables.size(); i++)
+    delete own_tables[i];
+  delete timing;
+}
+
+int cacheHierarchy::find(const std::string & name)
+{
+  for (size_t i = 0; i < cfgs.size(); i++)
+  {
+    if (cfgs[i].name == name)
+      return (int) i;
+  }
+  return -1;
+}
+
+bool cacheHierarchy::parse(std::istream & in, std::string & err)
+{
+  std::string raw;
+  int line_no = 0;
+  bool in_memory = false;
+  levelConfig * cur = 0;
+
+  while (std::getline(in, raw))
+  {
+    line_no++;
+    std::string line = raw.substr(0, raw.find_first_of("#;"));
+    line = trim(line);
+    if (line.empty())
+      continue;
+
+    std::ostringstream where;
+    where << "line " << line_no << ": ";
+
+    if (line[0] == '[')
+    {
+      if (line[line.size() - 1] != ']')
+      {
+        err = where.str() + "malformed section header";
+        return false;
+      }
+      std::string name = trim(line.substr(1, line.size() - 2));
+      in_memory = (name == "memory");
+      cur = 0;
+      if (in_memory)
+        continue;
+      if (name.empty() || find(name) >= 0)
+      {
+        err = where.str() + "empty or duplicate cache name '" + name + "'";
+        return false;
+      }
+      cfgs.push_back(levelConfig());
+      cur = &cfgs.back();
+      cur->name = name;
+      cur->line = line_no;
+      continue;
+    }
+
+    size_t eq = line.find('=');
+    if (eq == std::string::npos || (!cur && !in_memory))
+    {
+      err = where.str() + "expected key = value inside a section";
+      return false;
+    }
+    std::string key = trim(line.substr(0, eq));
+    std::string val = trim(line.substr(eq + 1));
+
+    bool ok = true;
+    if (in_memory)
+    {
+      if (key == "latency") ok = to_int(val, mem_latency);
+      else ok = false;
+    }
+    else if (key == "role") cur->role = val;
+    else if (key == "size") ok = to_int(val, cur->size_kb);
+    else if (key == "block") ok = to_int(val, cur->block_b);
+    else if (key == "ways") ok = to_int(val, cur->ways);
+    else if (key == "parent") cur->parent = val;
+    else if (key == "dbp") cur->dbp = val;
+    else if (key == "tables") cur->tables = val;
+    else if (key == "repl") cur->repl = val;
+    else if (key == "prefetch") cur->prefetch = val;
+    else if (key == "inclusion") cur->inclusion = val;
+    else if (key == "latency") ok = to_int(val, cur->latency);
+    else if (key == "mshrs") ok = to_int(val, cur->mshrs);
+    else if (key == "wbb") ok = to_int(val, cur->wbb);
+    else if (key == "vc") ok = to_int(val, cur->vc);
+    else ok = false;
+
+    if (!ok)
+    {
+      err = where.str() + "bad key or value '" + line + "'";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool cacheHierarchy::validate(std::string & err)
+{
+  if (cfgs.empty())
+  {
+    err = "no cache sections";
+    return false;
+  }
+
+  int n_icache = 0, n_dcache = 0;
+  for (size_t i = 0; i < cfgs.size(); i++)
+  {
+    levelConfig & c = cfgs[i];
+    std::ostringstream where;
+    where << "[" << c.name << "] (line " << c.line << "): ";
+
+    if (c.dbp.empty())
+      c.dbp = (c.role == "none") ? "refcount" : "trace";
+
+    long num_sets = ((long) c.size_kb * 1024 / c.block_b) / c.ways;
+    if (!IS_POW_2(c.block_b) || c.block_b < 2 || num_sets < 2 || !IS_POW_2(num_sets)
+        || num_sets * c.ways * c.block_b != (long) c.size_kb * 1024)
+    {
+      err = where.str() + "size/block/ways must give a power-of-two number (>= 2) of sets";
+      return false;
+    }
+    if (c.role == "icache" || c.role == "unified")
+      n_icache++;
+    if (c.role == "dcache" || c.role == "unified")
+      n_dcache++;
+    if (c.role != "icache" && c.role != "dcache" && c.role != "unified" && c.role != "none")
+    {
+      err = where.str() + "role must be icache, dcache, unified or none";
+      return false;
+    }
+    if (c.parent != "memory" && find(c.parent) < 0)
+    {
+      err = where.str() + "unknown parent '" + c.parent + "'";
+      return false;
+    }
+    if (c.dbp != "trace" && c.dbp != "refcount" && c.dbp != "none")
+    {
+      err = where.str() + "dbp must be trace, refcount or none";
+      return false;
+    }
+    if (c.tables != "shared" && c.tables != "private")
+    {
+      err = where.str() + "tables must be shared or private";
+      return false;
+    }
+    if (parse_repl(c.repl) == NUM_REPL)
+    {
+      err = where.str() + "unknown replacement policy '" + c.repl + "'";
+      return false;
+    }
+    if (c.inclusion != "nine" && c.inclusion != "inclusive" && c.inclusion != "exclusive")
+    {
+      err = where.str() + "inclusion must be nine, inclusive or exclusive";
+      return false;
+    }
+    if (c.inclusion == "exclusive" && c.role != "none")
+    {
+      err = where.str() + "an exclusive cache cannot be an entry point";
+      return false;
+    }
+    if (c.inclusion == "exclusive" && (c.wbb || c.vc))
+    {
+      err = where.str() + "an exclusive cache cannot have a write-back buffer or victim cache";
+      return false;
+    }
+    std::vector<prefetcher *> check;
+    if (!parse_prefetchers(c.prefetch, check))
+    {
+      err = where.str() + "bad prefetch list '" + c.prefetch + "'";
+      return false;
+    }
+    for (size_t k = 0; k < check.size(); k++)
+      delete check[k];
+  }
+  if (n_icache != 1 || n_dcache != 1)
+  {
+    err = "exactly one icache and one dcache (or a single unified cache) are required";
+    return false;
+  }
+  return true;
+}
+
+//parents are built before their children; state: 0 new, 1 in progress, 2 built
+cacheSim * cacheHierarchy::build_level(size_t idx, std::vector<int> & state)
+{
+  if (state[idx] == 2)
+    return caches[idx];
+  if (state[idx] == 1)
+    return 0; //cycle
+  state[idx] = 1;
+
+  levelConfig & c = cfgs[idx];
+  cacheSim * parent = 0;
+  if (c.parent != "memory")
+  {
+    parent = build_level(find(c.parent), state);
+    if (!parent)
+      return 0;
+  }
+
+  cacheSim * cache = new cacheSim(c.size_kb, c.block_b, c.ways, parent);
+  cache->dbp_enable = (c.dbp != "none");
+  cache->dbp_use_refcount = (c.dbp == "refcount");
+  cache->repl = parse_repl(c.repl);
+  if (c.inclusion == "inclusive")
+    cache->inclusion = INCL_INCLUSIVE;
+  else if (c.inclusion == "exclusive")
+    cache->inclusion = INCL_EXCLUSIVE;
+  if (c.tables == "private")
+  {
+    own_tables.push_back(new dbpTables());
+    cache->dbp_tbl = own_tables.back();
+  }
+  std::vector<prefetcher *> engines;
+  parse_prefetchers(c.prefetch, engines);
+  for (size_t k = 0; k < engines.size(); k++)
+    cache->add_prefetcher(engines[k]);
+  cache->tm.hit_latency = c.latency;
+  cache->tm.mshrs = c.mshrs;
+  if (c.wbb)
+    cache->wbb = new wbBuffer(c.wbb);
+  if (c.vc)
+    cache->vc = new victimCache(c.vc);
+  if (parent)
+    parent->children.push_back(cache);
+
+  caches[idx] = cache;
+  state[idx] = 2;
+  return cache;
+}
+
+bool cacheHierarchy::load(const std::string & file, std::string & err)
+{
+  std::ifstream in(file.c_str());
+  if (!in.good())
+  {
+    err = "cannot open " + file;
+    return false;
+  }
+  if (!parse(in, err) || !validate(err))
+    return false;
+
+  caches.assign(cfgs.size(), (cacheSim *) 0);
+  std::vector<int> state(cfgs.size(), 0);
+  for (size_t i = 0; i < cfgs.size(); i++)
+  {
+    if (!build_level(i, state))
+    {
+      err = "parent cycle through [" + cfgs[i].name + "]";
+      return false;
+    }
+  }
+  for (size_t i = 0; i < cfgs.size(); i++)
+  {
+    if (cfgs[i].role == "icache" || cfgs[i].role == "unified")
+      icache = caches[i];
+    if (cfgs[i].role == "dcache" || cfgs[i].role == "unified")
+      dcache = caches[i];
+  }
+  return true;
+}
+
+timingModel * cacheHierarchy::enable_timing()
+{
+  if (!timing)
+  {
+    timing = new timingModel(mem_latency);
+    for (size_t i = 0; i < caches.size(); i++)
+      caches[i]->timing = timing;
+  }
+  return timing;
+}
+
+//levels are in file order, not parent order: repeat until a pass drains nothing, as
+//draining a level can queue write-backs in its parent's buffer
+void cacheHierarchy::drain_write_backs()
+{
+  long n;
+  do
+  {
+    n = 0;
+    for (size_t i = 0; i < caches.size(); i++)
+      n += caches[i]->drain_write_backs();
+  } while (n);
+}
+
+void cacheHierarchy::report(std::ostream & out)
+{
+  for (size_t i = 0; i < caches.size(); i++)
+  {
+    levelConfig & c = cfgs[i];
+    cacheSim * cache = caches[i];
+    std::string p = c.name;
+
+    out << "\n[" << c.name << "] " << c.size_kb << "KB " << c.block_b << "B " << c.ways << "-way, role " << c.role
+        << ", parent " << c.parent << ", " << c.inclusion << ", dbp " << c.dbp << ", repl " << c.repl << std::endl;
+    out << p << " ACCESS COUNT: " << cache->get_access_cnt() << std::endl;
+    out << p << " MISS COUNT: " << cache->get_miss_cnt() << std::endl;
+    out << p << " DEAD BLK PRED: " << cache->get_dbp_cnt() << std::endl;
+    out << p << " EVICTIONS: " << cache->get_evicted_cnt() << std::endl;
+    out << p << " DBP MISS_PRED: " << cache->get_dbp_miss_pred() << std::endl;
+    if (cache->dbp_enable)
+    {
+      cacheMetrics m = cache->metrics(0);
+      out << p << " DBP ACCURACY : " << m.dbp_accuracy << std::endl;
+      out << p << " DBP COVERAGE : " << m.dbp_coverage << std::endl;
+    }
+    out << p << " TCP Prefetches: " << cache->get_tcp_pr_cnt() << std::endl;
+    out << p << " TCP Useless Prefetches: " << cache->get_useless_pr_cnt() << std::endl;
+    out << p << " BYPASSED FILLS: " << cache->get_bypass_cnt() << std::endl;
+    out << p << " BACK INVALIDATIONS: " << cache->get_back_inval_cnt() << std::endl;
+    out << p << " WRITE-BACKS RECEIVED: " << cache->get_wb_cnt() << std::endl;
+    out << p << " WRITE-BACK FILLS: " << cache->get_wb_fill_cnt() << std::endl;
+    if (cache->wbb)
+      cache->wbb->report(out, p);
+    if (cache->vc)
+      cache->vc->report(out, p);
+    for (size_t k = 0; k < cache->get_prefetchers().size(); k++)
+      cache->get_prefetchers()[k]->report(out, p, cache->get_miss_cnt());
+#ifdef BLK_LIFETIME_STATS
+    cache->report_lifetimes(out, p);
+#endif
+    if (timing)
+      cache->tm.report(out, p, cache->get_access_cnt());
+  }
+  if (timing)
+  {
+    out << std::endl;
+    timing->report(out);
+  }
+}
@@ -0,0 +1,94 @@
+#ifndef _HIER_BUILDER_H_
+#define _HIER_BUILDER_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "cacheSim.h"
+
+//Cache hierarchy description file
+//
+//One [section] per cache, any number of levels; '#' or ';' start a comment.
+//
+//  [l1d]
+//  role      = dcache            # icache, dcache, unified (both) or none (inner level)
+//  size      = 32                # KB
+//  block     = 64                # B
+//  ways      = 8
+//  parent    = l2                # next level; memory (default) for the last level
+//  dbp       = trace             # trace (BurstTrace), refcount (RefCount+) or none
+//  tables    = shared            # shared: global DBP/TCP tables, private: own copy
+//  repl      = lru               # see replPolicy.h
+//  prefetch  = stride:2:4        # see prefetcher.h
+//  inclusion = nine              # nine, inclusive or exclusive (towards its children)
+//  latency   = 4                 # hit latency (timing model)
+//  mshrs     = 8
+//  wbb       = 8                 # coalescing write-back buffer entries (default: none)
+//  vc        = 8                 # victim cache entries (default: none)
+//
+//  [memory]
+//  latency   = 200
+//
+//dbp defaults to trace for levels with a role and refcount for inner levels, which
+//with tables = shared reproduces the built-in L1-I/L1-D/L2 hierarchy of dbpSim.
+
+struct levelConfig
+{
+  std::string name;
+  std::string role;
+  int size_kb;
+  int block_b;
+  int ways;
+  std::string parent;
+  std::string dbp;
+  std::string tables;
+  std::string repl;
+  std::string prefetch;
+  std::string inclusion;
+  int latency;
+  int mshrs;
+  int wbb;
+  int vc;
+  int line;   //line of the section header (error messages)
+
+  levelConfig();
+};
+
+class cacheHierarchy
+{
+  std::vector<levelConfig> cfgs;
+  std::vector<cacheSim *> caches;       //same order as cfgs
+  std::vector<dbpTables *> own_tables;
+  timingModel * timing;
+  int mem_latency;
+
+  bool parse(std::istream & in, std::string & err);
+  bool validate(std::string & err);
+  cacheSim * build_level(size_t idx, std::vector<int> & state);
+  int find(const std::string & name);
+
+public :
+  //entry points of the instruction and data streams (may be the same cache)
+  cacheSim * icache;
+  cacheSim * dcache;
+
+  cacheHierarchy();
+  ~cacheHierarchy();
+
+  //parse and instantiate a hierarchy file; on failure err describes the problem
+  bool load(const std::string & file, std::string & err);
+
+  //attach a shared timing model to all levels (latencies/MSHRs from the file)
+  timingModel * enable_timing();
+
+  size_t num_levels() { return caches.size(); }
+  cacheSim * level(size_t i) { return caches[i]; }
+  const levelConfig & config(size_t i) { return cfgs[i]; }
+
+  //drain the write-back buffers of all levels into their parents (end of a run)
+  void drain_write_backs();
+
+  void report(std::ostream & out);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "intervalStats.h"
+#include <algorithm>
+
+intervalRecorder::intervalRecorder(std::ostream * out) : out(out), intervals(0)
+{
+}
+
+intervalCounts intervalRecorder::snapshot(cacheSim * c)
+{
+  intervalCounts s;
+  s.access = c->get_access_cnt();
+  s.miss = c->get_miss_cnt();
+  s.dbp = c->get_dbp_cnt();
+  s.dbp_miss_pred = c->get_dbp_miss_pred();
+  s.pf = c->get_tcp_pr_cnt();
+  s.pf_useless = c->get_useless_pr_cnt();
+  const std::vector<prefetcher *> & engines = c->get_prefetchers();
+  for (size_t i = 0; i < engines.size(); i++)
+  {
+    s.pf += engines[i]->issued;
+    s.pf_useless += engines[i]->useless;
+  }
+  return s;
+}
+
+void intervalRecorder::add_cache(const std::string & name, cacheSim * cache)
+{
+  tracked t;
+  t.name = name;
+  t.cache = cache;
+  t.last = snapshot(cache);
+  caches.push_back(t);
+}
+
+void intervalRecorder::end_interval(long instrs)
+{
+  if (intervals == 0)
+  {
+    *out << "interval,instructions";
+    for (size_t i = 0; i < caches.size(); i++)
+    {
+      const std::string & p = caches[i].name;
+      *out << "," << p << "_access," << p << "_miss," << p << "_dbp," << p << "_dbp_mispred,"
+           << p << "_pf," << p << "_pf_useless";
+    }
+    *out << "\n";
+  }
+
+  *out << intervals << "," << instrs;
+  for (size_t i = 0; i < caches.size(); i++)
+  {
+    intervalCounts now = snapshot(caches[i].cache);
+    intervalCounts & l = caches[i].last;
+    *out << "," << now.access - l.access << "," << now.miss - l.miss << "," << now.dbp - l.dbp
+         << "," << now.dbp_miss_pred - l.dbp_miss_pred << "," << now.pf - l.pf << "," << now.pf_useless - l.pf_useless;
+    l = now;
+  }
+  *out << "\n";
+  intervals++;
+}
+
+bbvProfile::bbvProfile(std::ostream * out) : counts(1, 0), out(out)
+{
+}
+
+unsigned bbvProfile::new_block()
+{
+  counts.push_back(0);
+  return (unsigned) counts.size() - 1;
+}
+
+void bbvProfile::end_interval()
+{
+  std::sort(touched.begin(), touched.end());
+  *out << "T";
+  for (size_t i = 0; i < touched.size(); i++)
+  {
+    *out << ":" << touched[i] << ":" << counts[touched[i]] << " ";
+    counts[touched[i]] = 0;
+  }
+  *out << "\n";
+  touched.clear();
+}
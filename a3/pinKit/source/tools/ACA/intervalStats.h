@@ -0,0 +1,76 @@
+#ifndef _INTERVAL_STATS_H_
+#define _INTERVAL_STATS_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "cacheSim.h"
+
+//Interval statistics of a cache hierarchy and basic-block vectors
+//
+//intervalRecorder writes one CSV row per interval with the per-level deltas of
+//accesses, misses, DBP predictions/mispredictions and prefetches (TCP + engines) and
+//their useless part. bbvProfile writes the instruction-weighted basic-block vector of
+//every interval in SimPoint's .bb format ("T:id:count :id:count ..."), so intervals can
+//be clustered into phases and representative regions picked for sampling.
+
+//counters of one cache at an interval boundary
+struct intervalCounts
+{
+  long access;
+  long miss;
+  long dbp;
+  long dbp_miss_pred;
+  long pf;
+  long pf_useless;
+};
+
+class intervalRecorder
+{
+  struct tracked
+  {
+    std::string name;
+    cacheSim * cache;
+    intervalCounts last;
+  };
+  std::vector<tracked> caches;
+  std::ostream * out;
+  long intervals;
+
+  static intervalCounts snapshot(cacheSim * c);
+
+public :
+  explicit intervalRecorder(std::ostream * out);
+
+  //track a cache; name is the CSV column prefix. All caches must be added before the
+  //first interval ends (the header is written then).
+  void add_cache(const std::string & name, cacheSim * cache);
+
+  //an interval of `instrs` instructions ended: write its row
+  void end_interval(long instrs);
+};
+
+class bbvProfile
+{
+  std::vector<unsigned long> counts;  //instructions per block id in this interval
+  std::vector<unsigned> touched;      //ids with a non-zero count
+  std::ostream * out;
+
+public :
+  explicit bbvProfile(std::ostream * out);
+
+  //allocate the id of a new basic block (ids start at 1, as SimPoint expects)
+  unsigned new_block();
+
+  void count(unsigned id, unsigned n)
+  {
+    if (!counts[id])
+      touched.push_back(id);
+    counts[id] += n;
+  }
+
+  //write the vector of the finished interval and clear it
+  void end_interval();
+};
+
+#endif
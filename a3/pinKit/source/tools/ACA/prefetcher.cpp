@@ -0,0 +1,235 @@
+#include "prefetcher.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+
+prefetcher::prefetcher(const std::string & n, int deg, int dist)
+ : blk_offs(0), name(n), degree(deg), distance(dist), issued(0), useful(0), late(0), useless(0), dropped(0)
+{
+}
+
+//accuracy: used (timely or late) prefetches per issued prefetch
+//coverage: demand misses removed out of the misses that would have happened
+void prefetcher::metrics(long demand_miss, double & accuracy, double & coverage, double & lateness)
+{
+  accuracy = safe_ratio((double)(useful + late), (double) issued);
+  coverage = safe_ratio((double) useful, (double)(useful + demand_miss));
+  lateness = safe_ratio((double) late, (double)(useful + late));
+}
+
+void prefetcher::report(std::ostream & out, const std::string & prefix, long demand_miss)
+{
+  double accuracy, coverage, lateness;
+  metrics(demand_miss, accuracy, coverage, lateness);
+
+  std::string p = prefix + " " + name + " PF";
+  out << p << " ISSUED: " << issued << std::endl;
+  out << p << " USEFUL: " << useful << std::endl;
+  out << p << " LATE: " << late << std::endl;
+  out << p << " USELESS: " << useless << std::endl;
+  out << p << " DROPPED: " << dropped << std::endl;
+  out << p << " ACCURACY : " << accuracy << std::endl;
+  out << p << " COVERAGE : " << coverage << std::endl;
+  out << p << " LATENESS : " << lateness << std::endl;
+}
+
+void prefetcher::register_stats(statsRegistry & reg, const std::string & group, long demand_miss)
+{
+  double accuracy, coverage, lateness;
+  metrics(demand_miss, accuracy, coverage, lateness);
+
+  std::string p = name + "_pf_";
+  reg.add_counter(group, p + "issued", issued);
+  reg.add_counter(group, p + "useful", useful);
+  reg.add_counter(group, p + "late", late);
+  reg.add_counter(group, p + "useless", useless);
+  reg.add_counter(group, p + "dropped", dropped);
+  reg.add_metric(group, p + "accuracy", accuracy);
+  reg.add_metric(group, p + "coverage", coverage);
+  reg.add_metric(group, p + "lateness", lateness);
+}
+
+stridePrefetcher::stridePrefetcher(int deg, int dist) : prefetcher("stride", deg, dist)
+{
+  StrideEntry e = { 0, 0, 0, 0 };
+  tbl.resize(STRIDE_TBL_SIZE, e);
+}
+
+void stridePrefetcher::train(size_t addr, size_t pc, bool, bool, std::vector<size_t> & pf_addrs)
+{
+  StrideEntry & e = tbl[(pc >> 2) & (STRIDE_TBL_SIZE - 1)];
+  if (e.pc != pc)
+  {
+    e.pc = pc;
+    e.last_addr = addr;
+    e.stride = 0;
+    e.conf = 0;
+    return;
+  }
+
+  long stride = (long)(addr - e.last_addr);
+  e.last_addr = addr;
+  if (stride == 0)
+    return;
+
+  if (stride == e.stride)
+  {
+    if (e.conf < STRIDE_CONF_MAX)
+      e.conf++;
+  }
+  else
+  {
+    e.stride = stride;
+    e.conf = 0;
+    return;
+  }
+  if (e.conf < STRIDE_CONF_ISSUE)
+    return;
+
+  //strides smaller than a block would prefetch the same block several times
+  size_t last_blk = addr >> blk_offs;
+  for (int i = 0; i < degree; i++)
+  {
+    size_t blk = (addr + stride * (distance + i)) >> blk_offs;
+    if (blk == last_blk)
+      continue;
+    pf_addrs.push_back(blk << blk_offs);
+    last_blk = blk;
+  }
+}
+
+streamPrefetcher::streamPrefetcher(int deg, int dist)
+ : prefetcher("stream", deg, dist), miss_pos(0), tick(0)
+{
+  Stream st = { false, 0, 0, 0, 0 };
+  streams.resize(NUM_STREAMS, st);
+  miss_hist.resize(STREAM_MISS_HIST, (size_t) -1);
+}
+
+//keep the stream [blk + distance, blk + distance + degree) ahead of the demand block
+void streamPrefetcher::issue(Stream & st, size_t blk, std::vector<size_t> & pf_addrs)
+{
+  for (int i = 0; i < degree; i++)
+  {
+    size_t tgt = blk + st.dir * (distance + i);
+    if ((long)(tgt - st.frontier) * st.dir <= 0)
+      continue;
+    pf_addrs.push_back(tgt << blk_offs);
+    st.frontier = tgt;
+  }
+}
+
+void streamPrefetcher::train(size_t addr, size_t, bool miss, bool, std::vector<size_t> & pf_addrs)
+{
+  size_t blk = addr >> blk_offs;
+  tick++;
+
+  //1) advance a stream the access belongs to
+  for (int s = 0; s < NUM_STREAMS; s++)
+  {
+    Stream & st = streams[s];
+    if (!st.valid)
+      continue;
+    long ahead = (long)(blk - st.last_blk) * st.dir;
+    if (ahead > 0 && ahead <= distance + degree)
+    {
+      st.last_blk = blk;
+      st.lru = tick;
+      issue(st, blk, pf_addrs);
+      return;
+    }
+  }
+  if (!miss)
+    return;
+
+  //2) allocate a stream if an adjacent block missed recently
+  long dir = 0;
+  for (int i = 0; i < STREAM_MISS_HIST && dir == 0; i++)
+  {
+    if (miss_hist[i] == blk - 1)
+      dir = 1;
+    else if (miss_hist[i] == blk + 1)
+      dir = -1;
+  }
+  miss_hist[miss_pos] = blk;
+  miss_pos = (miss_pos + 1) % STREAM_MISS_HIST;
+  if (dir == 0)
+    return;
+
+  int victim = 0;
+  for (int s = 0; s < NUM_STREAMS; s++)
+  {
+    if (!streams[s].valid)
+    {
+      victim = s;
+      break;
+    }
+    if (streams[s].lru < streams[victim].lru)
+      victim = s;
+  }
+  Stream & st = streams[victim];
+  st.valid = true;
+  st.dir = dir;
+  st.last_blk = blk;
+  st.frontier = blk;
+  st.lru = tick;
+  issue(st, blk, pf_addrs);
+}
+
+nextLinePrefetcher::nextLinePrefetcher(int deg, int dist) : prefetcher("nextline", deg, dist)
+{
+}
+
+void nextLinePrefetcher::train(size_t addr, size_t, bool miss, bool pf_hit, std::vector<size_t> & pf_addrs)
+{
+  if (!miss && !pf_hit)
+    return;
+  size_t blk = addr >> blk_offs;
+  for (int i = 0; i < degree; i++)
+    pf_addrs.push_back((blk + distance + i) << blk_offs);
+}
+
+bool parse_prefetchers(const std::string & spec, std::vector<prefetcher *> & engines)
+{
+  std::vector<prefetcher *> built;
+  std::stringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ','))
+  {
+    if (item.empty())
+      continue;
+    std::string name = item;
+    int degree = 1;
+    int distance = 1;
+
+    size_t c1 = item.find(':');
+    if (c1 != std::string::npos)
+    {
+      name = item.substr(0, c1);
+      size_t c2 = item.find(':', c1 + 1);
+      degree = atoi(item.substr(c1 + 1, c2 == std::string::npos ? std::string::npos : c2 - c1 - 1).c_str());
+      if (c2 != std::string::npos)
+        distance = atoi(item.substr(c2 + 1).c_str());
+    }
+
+    prefetcher * pf = 0;
+    if (degree > 0 && distance > 0)
+    {
+      if (name == "stride")
+        pf = new stridePrefetcher(degree, distance);
+      else if (name == "stream")
+        pf = new streamPrefetcher(degree, distance);
+      else if (name == "nextline")
+        pf = new nextLinePrefetcher(degree, distance);
+    }
+    if (!pf)
+    {
+      for (size_t i = 0; i < built.size(); i++)
+        delete built[i];
+      return false;
+    }
+    built.push_back(pf);
+  }
+  engines.insert(engines.end(), built.begin(), built.end());
+  return true;
+}
@@ -0,0 +1,113 @@
+#ifndef _PREFETCHER_H_
+#define _PREFETCHER_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <iostream>
+#include "cacheStats.h"
+
+//Prefetch engines that can be attached to any cacheSim (cacheSim::add_prefetcher)
+//
+//An engine observes the demand accesses of its cache and returns block addresses to
+//prefetch. cacheSim queues the requests and fills them pf_fill_delay accesses later,
+//so a demand miss on a queued block is counted as a late prefetch. The TCP prefetcher
+//(tcp_prefetch) stays built into cacheSim and is reported separately.
+//
+//  degree   : blocks issued per trigger
+//  distance : how many blocks ahead of the trigger the first prefetch is
+
+#define STRIDE_TBL_SIZE   256   //PC-indexed reference prediction table entries
+#define STRIDE_CONF_MAX   3
+#define STRIDE_CONF_ISSUE 2     //issue once a stride has been seen twice in a row
+#define NUM_STREAMS       8     //stream buffers
+#define STREAM_MISS_HIST  16    //recent misses searched to detect a new stream
+
+class prefetcher
+{
+protected :
+  int blk_offs;
+
+public :
+  std::string name;
+  int degree;
+  int distance;
+
+  long issued;   //prefetches queued
+  long useful;   //prefetched blocks hit by a demand access
+  long late;     //demand misses on blocks still in the prefetch queue
+  long useless;  //prefetched blocks evicted without a demand reference
+  long dropped;  //requests filtered (already cached/queued, queue full) or cached by a demand fetch before the fill
+
+  prefetcher(const std::string & n, int deg, int dist);
+  virtual ~prefetcher() {}
+
+  //called by cacheSim when the engine is attached
+  void set_block_offset(int offs) { blk_offs = offs; }
+
+  //observe a demand access; pf_hit is true on the first demand hit of a block this
+  //engine prefetched. Block addresses to prefetch are appended to pf_addrs.
+  virtual void train(size_t addr, size_t pc, bool miss, bool pf_hit, std::vector<size_t> & pf_addrs) = 0;
+
+  //accuracy, coverage and lateness given the demand misses of the cache (see report)
+  void metrics(long demand_miss, double & accuracy, double & coverage, double & lateness);
+
+  void report(std::ostream & out, const std::string & prefix, long demand_miss);
+  //counters and metrics as "<name>_pf_*" values of group
+  void register_stats(statsRegistry & reg, const std::string & group, long demand_miss);
+};
+
+//reference prediction table indexed by PC; prefetches addr + stride * (distance .. distance + degree - 1)
+class stridePrefetcher : public prefetcher
+{
+  struct StrideEntry
+  {
+    size_t pc;
+    size_t last_addr;
+    long stride;
+    int conf;
+  };
+  std::vector<StrideEntry> tbl;
+
+public :
+  stridePrefetcher(int deg, int dist);
+  void train(size_t addr, size_t pc, bool miss, bool pf_hit, std::vector<size_t> & pf_addrs);
+};
+
+//stream buffers: two misses to adjacent blocks allocate a stream, which then runs
+//distance blocks ahead of the demand accesses that fall into it
+class streamPrefetcher : public prefetcher
+{
+  struct Stream
+  {
+    bool valid;
+    long dir;          //+1 / -1
+    size_t last_blk;   //last demand block in the stream
+    size_t frontier;   //last block prefetched
+    unsigned long lru;
+  };
+  std::vector<Stream> streams;
+  std::vector<size_t> miss_hist;
+  size_t miss_pos;
+  unsigned long tick;
+
+  void issue(Stream & st, size_t blk, std::vector<size_t> & pf_addrs);
+
+public :
+  streamPrefetcher(int deg, int dist);
+  void train(size_t addr, size_t pc, bool miss, bool pf_hit, std::vector<size_t> & pf_addrs);
+};
+
+//tagged next-N-line: triggers on a miss or the first hit of a block it prefetched
+class nextLinePrefetcher : public prefetcher
+{
+public :
+  nextLinePrefetcher(int deg, int dist);
+  void train(size_t addr, size_t pc, bool miss, bool pf_hit, std::vector<size_t> & pf_addrs);
+};
+
+//build engines from a comma-separated list of name[:degree[:distance]], e.g. "stride:2:4,nextline"
+//names: stride, stream, nextline. Returns false (and builds nothing) on a malformed spec.
+bool parse_prefetchers(const std::string & spec, std::vector<prefetcher *> & engines);
+
+#endif
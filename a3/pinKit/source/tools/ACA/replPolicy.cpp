@@ -0,0 +1,27 @@
+#include "replPolicy.h"
+
+static const char * repl_names[NUM_REPL] = { "lru", "srrip", "drrip", "ship", "dbp" };
+
+replState::replState() : psel(PSEL_MAX / 2), brrip_fills(0), dead_fills(0), shct(SHCT_SIZE, 1)
+{
+}
+
+replKind parse_repl(const std::string & name)
+{
+  for (int k = 0; k < NUM_REPL; k++)
+  {
+    if (name == repl_names[k])
+      return (replKind) k;
+  }
+  return NUM_REPL;
+}
+
+const char * repl_name(replKind kind)
+{
+  return (kind < NUM_REPL) ? repl_names[kind] : "unknown";
+}
+
+bool repl_shares_state(replKind kind)
+{
+  return kind == REPL_DRRIP || kind == REPL_SHIP || kind == REPL_DBP;
+}
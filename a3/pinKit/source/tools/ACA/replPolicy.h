@@ -0,0 +1,234 @@
+#ifndef _REPL_POLICY_H_
+#define _REPL_POLICY_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+//Replacement policies for cacheSim
+//
+//Each policy is a stateless struct of static hooks; cacheSim::access() switches on the
+//selected replKind once and calls a cacheSim::access_impl<Policy> instantiation, so the
+//hooks inline and there is no virtual call in the hot path. Per-cache policy state lives
+//in replState. A set is kept in recency order (back == MRU) by cacheSim for every policy
+//because the BurstTrace DBP depends on it; policies only pick victims and insertion state.
+//
+//  on_hit        : a block was hit
+//  on_miss       : a demand miss happened in set_idx (set dueling)
+//  bypass        : return true to not allocate the missing block
+//  on_insert     : initialise policy fields of a block being filled
+//  on_wb_insert  : same for a write-back fill that must not train (cacheSim::wb_train off)
+//  choose_victim : pick the block to evict from a full set
+//  on_evict      : a block leaves the cache (predictor training)
+
+enum replKind
+{
+  REPL_LRU = 0, REPL_SRRIP, REPL_DRRIP, REPL_SHIP, REPL_DBP, NUM_REPL
+};
+
+//parse a -repl knob value; returns NUM_REPL for unknown names
+replKind parse_repl(const std::string & name);
+const char * repl_name(replKind kind);
+
+//true if the policy keeps state shared by all sets of a cache (DRRIP PSEL, SHiP SHCT, DBP
+//bypass throttle); splitting the sets over several cacheSims then changes the results
+bool repl_shares_state(replKind kind);
+
+#define RRPV_MAX        3         //2-bit re-reference prediction values
+#define RRPV_LONG       (RRPV_MAX - 1)
+#define BRRIP_LONG_RATE 32        //BRRIP inserts with RRPV_LONG once every 32 fills
+#define DUEL_SET_MOD    32        //DRRIP leader sets: set % 32 == 0 (SRRIP), == 1 (BRRIP)
+#define PSEL_MAX        1023      //10-bit policy selector
+#define SHCT_SIZE       16384     //SHiP signature history counter table entries
+#define SHCT_MAX        7         //3-bit SHCT counters
+#define SHIP_NO_SIG     SHCT_SIZE //ship_sig of a blk that trains no SHCT entry
+#define DBP_TRAIN_RATE  8         //DBP policy still allocates 1 of 8 dead-on-arrival fills
+
+struct replState
+{
+  unsigned psel;                     //DRRIP: > PSEL_MAX / 2 selects BRRIP for follower sets
+  unsigned brrip_fills;              //BRRIP throttle
+  unsigned dead_fills;               //DBP bypass throttle
+  std::vector<unsigned char> shct;   //SHiP
+
+  replState();
+};
+
+static inline unsigned ship_signature(size_t pc)
+{
+  return (unsigned) (((pc >> 2) ^ (pc >> 16)) & (SHCT_SIZE - 1));
+}
+
+//true LRU: evict the head of the recency list
+struct lruPolicy
+{
+  static const bool uses_dbp = false;
+
+  template <class Blk> static void on_hit(replState &, Blk &, size_t) {}
+  static void on_miss(replState &, size_t) {}
+  static bool bypass(replState &, size_t, bool) { return false; }
+  template <class Blk> static void on_insert(replState &, Blk &, size_t, size_t, bool) {}
+  template <class Blk> static void on_wb_insert(replState &, Blk &) {}
+  template <class Blk> static void on_evict(replState &, const Blk &) {}
+
+  template <class Set>
+  static typename Set::iterator choose_victim(replState &, Set & set, size_t)
+  {
+    return set.begin();
+  }
+};
+
+//static RRIP (Jaleel et al., ISCA'10), hit priority
+struct srripPolicy
+{
+  static const bool uses_dbp = false;
+
+  template <class Blk> static void on_hit(replState &, Blk & blk, size_t) { blk.rrpv = 0; }
+  static void on_miss(replState &, size_t) {}
+  static bool bypass(replState &, size_t, bool) { return false; }
+  template <class Blk> static void on_insert(replState &, Blk & blk, size_t, size_t, bool) { blk.rrpv = RRPV_LONG; }
+  template <class Blk> static void on_wb_insert(replState &, Blk & blk) { blk.rrpv = RRPV_LONG; }
+  template <class Blk> static void on_evict(replState &, const Blk &) {}
+
+  //first block (in LRU order) with a distant RRPV; age the set until one exists
+  template <class Set>
+  static typename Set::iterator choose_victim(replState &, Set & set, size_t)
+  {
+    while (true)
+    {
+      for (typename Set::iterator it = set.begin(); it != set.end(); it++)
+        if (it->rrpv >= RRPV_MAX)
+          return it;
+      for (typename Set::iterator it = set.begin(); it != set.end(); it++)
+        it->rrpv++;
+    }
+  }
+};
+
+//dynamic RRIP: set dueling between SRRIP and bimodal RRIP insertion
+struct drripPolicy
+{
+  static const bool uses_dbp = false;
+
+  static bool use_brrip(replState & st, size_t set_idx)
+  {
+    size_t leader = set_idx % DUEL_SET_MOD;
+    if (leader == 0)
+      return false;
+    if (leader == 1)
+      return true;
+    return st.psel > PSEL_MAX / 2;
+  }
+
+  template <class Blk> static void on_hit(replState &, Blk & blk, size_t) { blk.rrpv = 0; }
+
+  //a miss in a leader set votes against its insertion policy
+  static void on_miss(replState & st, size_t set_idx)
+  {
+    size_t leader = set_idx % DUEL_SET_MOD;
+    if (leader == 0 && st.psel < PSEL_MAX)
+      st.psel++;
+    else if (leader == 1 && st.psel > 0)
+      st.psel--;
+  }
+
+  static bool bypass(replState &, size_t, bool) { return false; }
+
+  template <class Blk>
+  static void on_insert(replState & st, Blk & blk, size_t set_idx, size_t, bool)
+  {
+    if (use_brrip(st, set_idx))
+      blk.rrpv = (++st.brrip_fills % BRRIP_LONG_RATE == 0) ? RRPV_LONG : RRPV_MAX;
+    else
+      blk.rrpv = RRPV_LONG;
+  }
+
+  //no BRRIP throttle step
+  template <class Blk> static void on_wb_insert(replState &, Blk & blk) { blk.rrpv = RRPV_LONG; }
+
+  template <class Blk> static void on_evict(replState &, const Blk &) {}
+
+  template <class Set>
+  static typename Set::iterator choose_victim(replState & st, Set & set, size_t set_idx)
+  {
+    return srripPolicy::choose_victim(st, set, set_idx);
+  }
+};
+
+//SHiP-PC (Wu et al., MICRO'11): PC signatures learn which fills are never re-referenced
+struct shipPolicy
+{
+  static const bool uses_dbp = false;
+
+  template <class Blk>
+  static void on_hit(replState & st, Blk & blk, size_t)
+  {
+    blk.rrpv = 0;
+    if (blk.ship_sig != SHIP_NO_SIG && st.shct[blk.ship_sig] < SHCT_MAX)
+      st.shct[blk.ship_sig]++;
+  }
+
+  static void on_miss(replState &, size_t) {}
+  static bool bypass(replState &, size_t, bool) { return false; }
+
+  template <class Blk>
+  static void on_insert(replState & st, Blk & blk, size_t, size_t pc, bool)
+  {
+    blk.ship_sig = ship_signature(pc);
+    blk.rrpv = (st.shct[blk.ship_sig] == 0) ? RRPV_MAX : RRPV_LONG;
+  }
+
+  //no signature: the writer's PC says nothing about the reuse of the blk
+  template <class Blk>
+  static void on_wb_insert(replState &, Blk & blk)
+  {
+    blk.ship_sig = SHIP_NO_SIG;
+    blk.rrpv = RRPV_LONG;
+  }
+
+  template <class Blk>
+  static void on_evict(replState & st, const Blk & blk)
+  {
+    if (!blk.referenced && blk.ship_sig != SHIP_NO_SIG && st.shct[blk.ship_sig] > 0)
+      st.shct[blk.ship_sig]--;
+  }
+
+  template <class Set>
+  static typename Set::iterator choose_victim(replState & st, Set & set, size_t set_idx)
+  {
+    return srripPolicy::choose_victim(st, set, set_idx);
+  }
+};
+
+//dead-block-aware LRU: fills predicted dead on arrival are bypassed (except a training
+//sample, which is inserted already marked dead), and predicted-dead blocks are evicted
+//before the LRU block
+struct dbpPolicy
+{
+  static const bool uses_dbp = true;
+
+  template <class Blk> static void on_hit(replState &, Blk &, size_t) {}
+  static void on_miss(replState &, size_t) {}
+
+  static bool bypass(replState & st, size_t, bool dead_on_arrival)
+  {
+    if (!dead_on_arrival)
+      return false;
+    return (++st.dead_fills % DBP_TRAIN_RATE) != 0;
+  }
+
+  template <class Blk> static void on_insert(replState &, Blk &, size_t, size_t, bool) {}
+  template <class Blk> static void on_wb_insert(replState &, Blk &) {}
+  template <class Blk> static void on_evict(replState &, const Blk &) {}
+
+  template <class Set>
+  static typename Set::iterator choose_victim(replState &, Set & set, size_t)
+  {
+    for (typename Set::iterator it = set.begin(); it != set.end(); it++)
+      if (it->pred_dead)
+        return it;
+    return set.begin();
+  }
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "sampling.h"
+#include <cmath>
+
+smartsSampler::smartsSampler(long period, long unit, long detail_warm)
+ : period(period), unit(unit), detail_warm(detail_warm), phase(SMP_WARM), total_instrs(0),
+   measured_instrs(0), functional_warming(true)
+{
+  phase_len = period - unit - detail_warm;
+  //a period without warming starts detailed right away
+  if (phase_len <= 0)
+    next_phase();
+}
+
+sampleCounts smartsSampler::snapshot(cacheSim * c)
+{
+  sampleCounts s;
+  s.access = c->get_access_cnt();
+  s.miss = c->get_miss_cnt();
+  s.dbp = c->get_dbp_cnt();
+  s.dbp_miss_pred = c->get_dbp_miss_pred();
+  s.evicted = c->get_evicted_cnt();
+  return s;
+}
+
+void smartsSampler::add_cache(const std::string & name, cacheSim * cache)
+{
+  tracked t;
+  t.name = name;
+  t.cache = cache;
+  t.start = snapshot(cache);
+  caches.push_back(t);
+}
+
+long smartsSampler::next_phase()
+{
+  total_instrs += phase_len;
+
+  if (phase == SMP_MEASURE)
+  {
+    measured_instrs += phase_len;
+    for (size_t i = 0; i < caches.size(); i++)
+    {
+      sampleCounts now = snapshot(caches[i].cache);
+      sampleCounts & s = caches[i].start;
+      sampleCounts d = { now.access - s.access, now.miss - s.miss, now.dbp - s.dbp,
+                         now.dbp_miss_pred - s.dbp_miss_pred, now.evicted - s.evicted };
+      caches[i].units.push_back(d);
+    }
+  }
+
+  //skip empty phases (no warming, or no detailed warming)
+  do
+  {
+    phase = (samplePhase) ((phase + 1) % 3);
+    if (phase == SMP_WARM)
+      phase_len = period - unit - detail_warm;
+    else if (phase == SMP_DETAIL_WARM)
+      phase_len = detail_warm;
+    else
+      phase_len = unit;
+  } while (phase_len <= 0);
+
+  if (phase == SMP_MEASURE)
+  {
+    for (size_t i = 0; i < caches.size(); i++)
+      caches[i].start = snapshot(caches[i].cache);
+  }
+  return phase_len;
+}
+
+//an incomplete measurement unit is dropped
+void smartsSampler::finish(long left)
+{
+  total_instrs += phase_len - left;
+}
+
+//ratio sum(y) / sum(x) over the units and the half-width of its confidence interval
+static void ratio_estimate(const std::vector<double> & y, const std::vector<double> & x, double z,
+                           double & ratio, double & half)
+{
+  double sy = 0, sx = 0;
+  size_t n = y.size();
+  for (size_t i = 0; i < n; i++)
+  {
+    sy += y[i];
+    sx += x[i];
+  }
+  ratio = sx ? sy / sx : 0.0;
+  half = 0.0;
+  if (n < 2 || !sx)
+    return;
+
+  double mean_x = sx / n;
+  double ss = 0;
+  for (size_t i = 0; i < n; i++)
+    ss += (y[i] - ratio * x[i]) * (y[i] - ratio * x[i]);
+  half = z * sqrt(ss / (n * (n - 1.0))) / mean_x;
+}
+
+void smartsSampler::report(std::ostream & out, int confidence)
+{
+  double z = (confidence == 90) ? 1.645 : (confidence == 99) ? 2.576 : 1.96;
+  double scale = measured_instrs ? (double) total_instrs / (double) measured_instrs : 0.0;
+
+  out << "SAMPLING PERIOD / DETAILED WARMING / UNIT (instructions): " << period << " / " << detail_warm << " / " << unit << std::endl;
+  out << "FUNCTIONAL WARMING: " << (functional_warming ? "on" : "off") << std::endl;
+  out << "TOTAL INSTRUCTIONS: " << total_instrs << std::endl;
+  out << "MEASURED INSTRUCTIONS: " << measured_instrs << std::endl;
+
+  for (size_t i = 0; i < caches.size(); i++)
+  {
+    const tracked & t = caches[i];
+    const std::string & p = t.name;
+    size_t n = t.units.size();
+    std::vector<double> acc(n), miss(n), dbp(n), correct(n), ev(n);
+    long sum_acc = 0, sum_miss = 0;
+    for (size_t k = 0; k < n; k++)
+    {
+      acc[k] = t.units[k].access;
+      miss[k] = t.units[k].miss;
+      dbp[k] = t.units[k].dbp;
+      correct[k] = t.units[k].dbp - t.units[k].dbp_miss_pred;
+      ev[k] = t.units[k].evicted;
+      sum_acc += t.units[k].access;
+      sum_miss += t.units[k].miss;
+    }
+
+    double r, h;
+    out << std::endl;
+    out << p << " SAMPLES: " << n << std::endl;
+    out << p << " EST. ACCESS COUNT: " << (long) (sum_acc * scale) << std::endl;
+    out << p << " EST. MISS COUNT: " << (long) (sum_miss * scale) << std::endl;
+    ratio_estimate(miss, acc, z, r, h);
+    out << p << " SAMPLED MISS RATE : " << r << " +- " << h << " (" << confidence << "% CI)" << std::endl;
+    if (t.cache->dbp_enable)
+    {
+      ratio_estimate(correct, dbp, z, r, h);
+      out << p << " SAMPLED DBP ACCURACY : " << r << " +- " << h << " (" << confidence << "% CI)" << std::endl;
+      ratio_estimate(correct, ev, z, r, h);
+      out << p << " SAMPLED DBP COVERAGE : " << r << " +- " << h << " (" << confidence << "% CI)" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "cacheSim.h"
+
+//SMARTS-style systematic sampling of a cache hierarchy
+//
+//The instruction stream is cut into periods of `period` instructions. Each period ends
+//with `detail_warm` instructions of detailed simulation (predictors and queues warm up,
+//counters are discarded) followed by a measurement unit of `unit` detailed instructions.
+//The rest of the period is functional warming (cacheSim::warm: tags and recency only),
+//or is skipped entirely without touching the caches.
+//
+//Every measurement unit is one sample of each tracked cache. Rates are estimated as
+//ratios of the summed counters, with a confidence interval from the variance of the
+//per-unit residuals (ratio estimator). Event counts of the whole run are extrapolated
+//from the measured fraction of instructions.
+
+enum samplePhase
+{
+  SMP_WARM = 0,      //functional warming, or skipping
+  SMP_DETAIL_WARM,   //detailed, not measured
+  SMP_MEASURE        //detailed and measured
+};
+
+//counters of one cache over one measurement unit
+struct sampleCounts
+{
+  long access;
+  long miss;
+  long dbp;
+  long dbp_miss_pred;
+  long evicted;
+};
+
+class smartsSampler
+{
+  struct tracked
+  {
+    std::string name;
+    cacheSim * cache;
+    sampleCounts start;
+    std::vector<sampleCounts> units;
+  };
+  std::vector<tracked> caches;
+
+  long period;
+  long unit;
+  long detail_warm;
+  samplePhase phase;
+  long phase_len;
+
+  long total_instrs;      //instructions of all completed phases
+  long measured_instrs;
+
+  static sampleCounts snapshot(cacheSim * c);
+
+public :
+  //true: the warm phase updates the caches functionally; false: it skips them
+  bool functional_warming;
+
+  smartsSampler(long period, long unit, long detail_warm);
+
+  //track a cache; all caches must be added before the first phase ends
+  void add_cache(const std::string & name, cacheSim * cache);
+
+  //false if unit + detail_warm does not fit in the period
+  bool valid() { return unit > 0 && detail_warm >= 0 && unit + detail_warm <= period; }
+
+  samplePhase get_phase() { return phase; }
+  bool detailed() { return phase != SMP_WARM; }
+  //length of the current phase in instructions
+  long get_phase_len() { return phase_len; }
+
+  //the current phase is over; starts the next one and returns its length
+  long next_phase();
+  //the run ended with `left` instructions of the current phase not executed
+  void finish(long left);
+
+  //confidence level in percent (90, 95 or 99)
+  void report(std::ostream & out, int confidence);
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <cassert>
+
+//bounded lock-free single-producer/single-consumer ring
+//each side caches the other side's index and only re-reads the atomic when it looks full/empty
+template <class T>
+class spscQueue
+{
+  //consumer- and producer-owned fields live on separate cache lines
+  std::vector<T> ring;
+  size_t mask;
+  char pad0[64];
+
+  std::atomic<size_t> head; //next slot to pop  (written by consumer)
+  size_t tail_cache;        //consumer's view of tail
+  char pad1[64];
+
+  std::atomic<size_t> tail; //next slot to push (written by producer)
+  size_t head_cache;        //producer's view of head
+  char pad2[64];
+
+public :
+  explicit spscQueue(size_t capacity) : head(0), tail_cache(0), tail(0), head_cache(0)
+  {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    ring.resize(capacity);
+    mask = capacity - 1;
+  }
+
+  //producer side; spins while the ring is full
+  void push(const T & item)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    while (t - head_cache == ring.size())
+    {
+      head_cache = head.load(std::memory_order_acquire);
+      if (t - head_cache == ring.size())
+        std::this_thread::yield();
+    }
+    ring[t & mask] = item;
+    tail.store(t + 1, std::memory_order_release);
+  }
+
+  //consumer side; spins while the ring is empty
+  T pop()
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    while (h == tail_cache)
+    {
+      tail_cache = tail.load(std::memory_order_acquire);
+      if (h == tail_cache)
+        std::this_thread::yield();
+    }
+    T item = ring[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return item;
+  }
+};
+
+#endif
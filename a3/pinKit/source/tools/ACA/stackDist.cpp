@@ -0,0 +1,197 @@
+#include "stackDist.h"
+#include <algorithm>
+#include <utility>
+
+//initial (and minimum) number of Fenwick slots
+#define MIN_SLOTS (1 << 16)
+
+static inline bool IS_POW_2(int num)
+{
+  return ((num & (num - 1)) == 0);
+}
+
+static inline int LOG2(size_t num)
+{
+  int retval = 0;
+  while (num > 1) {
+    num >>= 1;
+    ++retval;
+  }
+  return retval;
+}
+
+stackDistSim::stackDistSim(int b_sz_b, int max_kb, int ways)
+ : block_size_b(b_sz_b), max_ways(ways), access_cnt(0), cold_miss(0), next_slot(1)
+{
+  assert(IS_POW_2(b_sz_b) && IS_POW_2(max_kb) && ways > 0);
+  blk_offs = LOG2(b_sz_b);
+
+  size_t max_blocks = ((size_t)max_kb * 1024) / b_sz_b;
+  assert(max_blocks > 0);
+  max_set_bits = LOG2(max_blocks);
+
+  slot_bit.resize(MIN_SLOTS + 1, 0);
+  fa_hist.resize(8 * sizeof(size_t) + 1, 0);
+
+  //only keep the ways that still fit in max_kb for each set count
+  sa_stacks.resize(max_set_bits + 1);
+  for (int s = 0; s <= max_set_bits; s++)
+  {
+    SetStacks & st = sa_stacks[s];
+    st.depth = (int) std::min((size_t) max_ways, max_blocks >> s);
+    st.blks.resize(((size_t)1 << s) * st.depth, 0);
+    st.fill.resize((size_t)1 << s, 0);
+    st.hist.resize(st.depth, 0);
+  }
+}
+
+//Fenwick tree helpers; slots are 1-indexed
+long stackDistSim::bit_prefix(size_t slot)
+{
+  long sum = 0;
+  for (; slot > 0; slot -= slot & (~slot + 1))
+    sum += slot_bit[slot];
+  return sum;
+}
+
+void stackDistSim::bit_update(size_t slot, long delta)
+{
+  for (; slot < slot_bit.size(); slot += slot & (~slot + 1))
+    slot_bit[slot] += delta;
+}
+
+//renumber live slots to 1..N (keeping their order) once the slot space is used up
+void stackDistSim::compact()
+{
+  std::vector< std::pair<size_t, size_t> > live; //(slot, blk)
+  live.reserve(last_slot.size());
+  for (std::unordered_map<size_t, size_t>::iterator it = last_slot.begin(); it != last_slot.end(); it++)
+    live.push_back(std::make_pair(it->second, it->first));
+  std::sort(live.begin(), live.end());
+
+  size_t n_slots = std::max((size_t) MIN_SLOTS, 2 * live.size());
+  slot_bit.assign(n_slots + 1, 0);
+  for (size_t i = 0; i < live.size(); i++)
+  {
+    last_slot[live[i].second] = i + 1;
+    slot_bit[i + 1] = 1;
+  }
+  //O(n) Fenwick build
+  for (size_t i = 1; i <= n_slots; i++)
+  {
+    size_t up = i + (i & (~i + 1));
+    if (up <= n_slots)
+      slot_bit[up] += slot_bit[i];
+  }
+  next_slot = live.size() + 1;
+}
+
+//account a single access in every tracked configuration
+void stackDistSim::access(size_t addr)
+{
+  size_t blk = addr >> blk_offs;
+  access_cnt++;
+
+  //1) fully-associative stack distance
+  if (next_slot == slot_bit.size())
+    compact();
+
+  std::unordered_map<size_t, size_t>::iterator it = last_slot.find(blk);
+  if (it == last_slot.end())
+  {
+    cold_miss++;
+    last_slot[blk] = next_slot;
+  }
+  else
+  {
+    //number of distinct blocks touched since the last access to blk
+    size_t dist = bit_prefix(next_slot - 1) - bit_prefix(it->second);
+    fa_hist[(dist == 0) ? 0 : LOG2(dist) + 1]++;
+    bit_update(it->second, -1);
+    it->second = next_slot;
+  }
+  bit_update(next_slot, 1);
+  next_slot++;
+
+  //2) per-set LRU stacks for every set count
+  for (int s = 0; s <= max_set_bits; s++)
+  {
+    SetStacks & st = sa_stacks[s];
+    size_t set_idx = blk & (((size_t)1 << s) - 1);
+    size_t * stack = &st.blks[set_idx * st.depth];
+    int n = st.fill[set_idx];
+
+    int pos = 0;
+    while (pos < n && stack[pos] != blk)
+      pos++;
+
+    if (pos < n)
+      st.hist[pos]++;
+    else if (n < st.depth)
+      st.fill[set_idx] = n + 1;
+    else
+      pos = n - 1; //evict the LRU blk
+
+    //move blk to the MRU position
+    for (int i = pos; i > 0; i--)
+      stack[i] = stack[i - 1];
+    stack[0] = blk;
+  }
+}
+
+long stackDistSim::get_access_cnt()
+{
+  return access_cnt;
+}
+
+//LRU miss ratio of a size_kb cache; ways == 0 selects full associativity
+//returns -1 for configurations that are not tracked
+double stackDistSim::miss_ratio(int size_kb, int ways)
+{
+  if (access_cnt == 0)
+    return 0.0;
+
+  size_t blocks = ((size_t)size_kb * 1024) / block_size_b;
+  if (blocks == 0 || !IS_POW_2(blocks))
+    return -1.0;
+
+  long hits = 0;
+  if (ways == 0)
+  {
+    //a blk hits iff its stack distance is < blocks; bins 0..log2(blocks) cover [0, blocks)
+    int max_bin = LOG2(blocks);
+    for (int b = 0; b <= max_bin; b++)
+      hits += fa_hist[b];
+  }
+  else
+  {
+    if (!IS_POW_2(ways) || blocks < (size_t) ways)
+      return -1.0;
+    int s = LOG2(blocks / ways);
+    if (s > max_set_bits || ways > sa_stacks[s].depth)
+      return -1.0;
+    for (int d = 0; d < ways; d++)
+      hits += sa_stacks[s].hist[d];
+  }
+  return access_cnt ? (double)(access_cnt - hits) / (double) access_cnt : 0.0;
+}
+
+void stackDistSim::report(std::ostream & out, const std::string & prefix)
+{
+  size_t max_kb = ((((size_t)1) << max_set_bits) * block_size_b) / 1024;
+
+  out << prefix << " MRC ACCESS COUNT: " << access_cnt << std::endl;
+  out << prefix << " MRC COLD MISSES: " << cold_miss << std::endl;
+  for (size_t kb = 1; kb <= max_kb; kb <<= 1)
+  {
+    if (kb * 1024 < (size_t) block_size_b)
+      continue;
+    out << prefix << " MRC " << kb << "KB FA : " << miss_ratio(kb, 0) << std::endl;
+    for (int w = 1; w <= max_ways; w <<= 1)
+    {
+      double ratio = miss_ratio(kb, w);
+      if (ratio >= 0.0)
+        out << prefix << " MRC " << kb << "KB " << w << "-WAY : " << ratio << std::endl;
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef _STACK_DIST_H_
+#define _STACK_DIST_H_
+
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <string>
+#include <cassert>
+
+//Single-pass LRU stack-distance engine; fed with the same access stream as a cacheSim
+//and produces miss-ratio curves for every (power-of-two) cache size and associativity
+//
+//- fully-associative distances: Bennett-Kruskal counter over access slots (Fenwick tree),
+//  compacted when it fills up, so memory is O(distinct blocks)
+//- set-associative distances: one bounded LRU stack per set for every power-of-two set
+//  count (all-associativity simulation); depth is capped so sets*ways*blk <= max size
+class stackDistSim
+{
+  int block_size_b;
+  int blk_offs;
+  int max_set_bits;
+  int max_ways;
+
+  long access_cnt;
+  long cold_miss;
+
+  //fully-associative LRU stack (Olken / Bennett-Kruskal)
+  std::unordered_map<size_t, size_t> last_slot; //blk addr -> slot of its last access
+  std::vector<long> slot_bit;                   //Fenwick tree; 1 marks the latest access to a blk
+  size_t next_slot;
+  std::vector<long> fa_hist;                    //log2-binned distances; bin k: [2^(k-1), 2^k)
+
+  //set-associative LRU stacks; one level per set count (1 << s)
+  struct SetStacks
+  {
+    int depth;                    //max ways tracked for this set count
+    std::vector<size_t> blks;     //[set * depth + pos], MRU first
+    std::vector<unsigned short> fill;
+    std::vector<long> hist;       //hits at stack depth d
+  };
+  std::vector<SetStacks> sa_stacks;
+
+  long bit_prefix(size_t slot);
+  void bit_update(size_t slot, long delta);
+  void compact();
+
+public :
+  stackDistSim(int b_sz_b, int max_kb, int ways);
+
+  void access(size_t addr);
+
+  long get_access_cnt();
+  double miss_ratio(int size_kb, int ways); //ways == 0: fully-associative
+
+  //dump MRCs in the same "PREFIX NAME : VALUE" layout as the Fini report
+  void report(std::ostream & out, const std::string & prefix);
+};
+
+#endif
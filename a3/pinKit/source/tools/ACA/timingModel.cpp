@@ -0,0 +1,43 @@
+#include "timingModel.h"
+#include <algorithm>
+
+void timingModel::report(std::ostream & out)
+{
+  out << "CYCLES: " << cycle << std::endl;
+  out << "INSTRUCTIONS: " << instrs << std::endl;
+  out << "IPC : " << (cycle ? (double) instrs / (double) cycle : 0.0) << std::endl;
+  out << "MEMORY STALL CYCLES: " << stall_cycles << std::endl;
+  out << "MEMORY STALL CYCLES PER 1K INSTRUCTIONS : " << (instrs ? 1000.0 * (double) stall_cycles / (double) instrs : 0.0) << std::endl;
+}
+
+long cacheTiming::alloc_mshr(long now)
+{
+  //retire completed misses
+  size_t n = 0;
+  for (size_t i = 0; i < mshr_ready.size(); i++)
+  {
+    if (mshr_ready[i] > now)
+      mshr_ready[n++] = mshr_ready[i];
+  }
+  mshr_ready.resize(n);
+
+  long wait = 0;
+  if ((int) n >= mshrs)
+  {
+    std::vector<long>::iterator oldest = std::min_element(mshr_ready.begin(), mshr_ready.end());
+    wait = *oldest - now;
+    mshr_full_cycles += wait;
+    mshr_ready.erase(oldest);
+  }
+  mshr_ready.push_back(now + wait);
+  return wait;
+}
+
+void cacheTiming::report(std::ostream & out, const std::string & prefix, long access_cnt)
+{
+  out << prefix << " HIT LATENCY: " << hit_latency << std::endl;
+  out << prefix << " AMAT : " << (access_cnt ? (double) total_latency / (double) access_cnt : 0.0) << std::endl;
+  out << prefix << " MSHR MERGES: " << mshr_merges << std::endl;
+  out << prefix << " MSHR FULL CYCLES: " << mshr_full_cycles << std::endl;
+  out << prefix << " PF PARTIAL HITS: " << pf_partial_hits << std::endl;
+}
@@ -0,0 +1,63 @@
+#ifndef _TIMING_MODEL_H_
+#define _TIMING_MODEL_H_
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+//Optional latency model for a cacheSim hierarchy
+//
+//The core is in-order with CPI 1: every instruction advances the shared clock by one
+//cycle, and an instruction fetch or load stalls it for the latency above an L1 hit.
+//Stores retire into a store buffer and never stall. Each cache charges its hit latency
+//plus the latency of the next level (or memory) on a miss. Every block records the cycle
+//its fill completes, so a hit on a block that is still in flight (a merged miss in the
+//MSHR, or a late prefetch) only waits for the rest of the fill. A miss that finds all
+//MSHRs busy waits for the oldest one to retire.
+
+//shared clock and memory parameters of the hierarchy
+struct timingModel
+{
+  long cycle;
+  long instrs;
+  long stall_cycles;
+  int mem_latency;
+
+  timingModel(int mem_lat) : cycle(0), instrs(0), stall_cycles(0), mem_latency(mem_lat) {}
+
+  void tick_instr() { cycle++; instrs++; }
+  void stall(long c)
+  {
+    if (c > 0)
+    {
+      cycle += c;
+      stall_cycles += c;
+    }
+  }
+
+  void report(std::ostream & out);
+};
+
+//per-cache latency configuration, MSHR file and counters
+struct cacheTiming
+{
+  int hit_latency;
+  int mshrs;
+  std::vector<long> mshr_ready;  //completion cycles of outstanding misses
+
+  long total_latency;     //summed over all demand accesses
+  long mshr_merges;       //hits on blocks whose fill is still in flight
+  long mshr_full_cycles;  //cycles misses waited for a free MSHR
+  long pf_partial_hits;   //demand hits on prefetches that had not arrived yet
+
+  cacheTiming() : hit_latency(1), mshrs(8), total_latency(0), mshr_merges(0), mshr_full_cycles(0), pf_partial_hits(0) {}
+
+  //reserve an MSHR at cycle now; returns the cycles spent waiting for one
+  long alloc_mshr(long now);
+  //the miss reserved last completes at cycle ready
+  void fill_mshr(long ready) { mshr_ready.back() = ready; }
+
+  void report(std::ostream & out, const std::string & prefix, long access_cnt);
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "tlbSim.h"
+#include <cassert>
+
+#define SMALL_REGION ((size_t) -1)
+#define FRAMES_PER_REGION (1UL << (PAGE_2M_BITS - PAGE_4K_BITS))
+
+tlbArray::tlbArray(int entries, int ways) : ways(ways), accesses(0), misses(0)
+{
+  int num_sets = entries / ways;
+  assert(num_sets > 0 && (num_sets & (num_sets - 1)) == 0);
+  set_mask = num_sets - 1;
+  sets.resize(num_sets, std::list<TlbEntry>());
+}
+
+bool tlbArray::probe(size_t vpn, bool huge, size_t & pfn)
+{
+  std::list<TlbEntry> & set = sets[vpn & set_mask];
+  for (std::list<TlbEntry>::iterator it = set.begin(); it != set.end(); it++)
+  {
+    if (it->vpn == vpn && it->huge == huge)
+    {
+      pfn = it->pfn;
+      set.splice(set.end(), set, it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool tlbArray::lookup(size_t vaddr, size_t & pfn, bool & huge)
+{
+  accesses++;
+  huge = false;
+  if (probe(vaddr >> PAGE_4K_BITS, false, pfn))
+    return true;
+  huge = true;
+  if (probe(vaddr >> PAGE_2M_BITS, true, pfn))
+    return true;
+  misses++;
+  return false;
+}
+
+void tlbArray::insert(size_t vaddr, size_t pfn, bool huge)
+{
+  TlbEntry e;
+  e.vpn = vaddr >> (huge ? PAGE_2M_BITS : PAGE_4K_BITS);
+  e.pfn = pfn;
+  e.huge = huge;
+  std::list<TlbEntry> & set = sets[e.vpn & set_mask];
+  if ((int) set.size() >= ways)
+    set.pop_front();
+  set.push_back(e);
+}
+
+physMem::physMem(int mem_mb, bool thp)
+ : next_region(0), small_region(0), small_next(FRAMES_PER_REGION), thp(thp), pages_4k(0), pages_2m(0), table_pages(0)
+{
+  num_regions = (size_t) mem_mb >> (PAGE_2M_BITS - 20);
+  assert(num_regions > 0 && (num_regions & (num_regions - 1)) == 0);
+}
+
+//scrambled region number; wraps around (aliasing) once physical memory is used up
+size_t physMem::alloc_region()
+{
+  return (next_region++ * PHYS_SCRAMBLE) & (num_regions - 1);
+}
+
+size_t physMem::alloc_frame()
+{
+  if (small_next == FRAMES_PER_REGION)
+  {
+    small_region = alloc_region();
+    small_next = 0;
+  }
+  size_t slot = (small_next++ * PHYS_SCRAMBLE) & (FRAMES_PER_REGION - 1);
+  return small_region * FRAMES_PER_REGION + slot;
+}
+
+size_t physMem::map(size_t vaddr, bool ifetch, bool & huge)
+{
+  size_t vpn_2m = vaddr >> PAGE_2M_BITS;
+  std::unordered_map<size_t, size_t>::iterator r = regions.find(vpn_2m);
+  if (r == regions.end())
+  {
+    //the page size of a virtual region is fixed at its first touch
+    size_t v = SMALL_REGION;
+    if (thp && !ifetch)
+    {
+      v = alloc_region();
+      pages_2m++;
+    }
+    r = regions.insert(std::make_pair(vpn_2m, v)).first;
+  }
+  huge = (r->second != SMALL_REGION);
+  if (huge)
+    return r->second;
+
+  size_t vpn_4k = vaddr >> PAGE_4K_BITS;
+  std::unordered_map<size_t, size_t>::iterator p = pages.find(vpn_4k);
+  if (p == pages.end())
+  {
+    p = pages.insert(std::make_pair(vpn_4k, alloc_frame())).first;
+    pages_4k++;
+  }
+  return p->second;
+}
+
+size_t physMem::pte_addr(int level, size_t vaddr)
+{
+  //a level-L table is selected by the vaddr bits above the ones it indexes
+  int idx_shift = PAGE_4K_BITS + PT_INDEX_BITS * (PT_LEVELS - 1 - level);
+  size_t key = ((size_t) level << 60) | (vaddr >> (idx_shift + PT_INDEX_BITS));
+  std::unordered_map<size_t, size_t>::iterator t = tables.find(key);
+  if (t == tables.end())
+  {
+    t = tables.insert(std::make_pair(key, alloc_frame())).first;
+    table_pages++;
+  }
+  size_t idx = (vaddr >> idx_shift) & ((1 << PT_INDEX_BITS) - 1);
+  return (t->second << PAGE_4K_BITS) | (idx << 3);
+}
+
+mmuSim::mmuSim(int itlb_e, int itlb_w, int dtlb_e, int dtlb_w, int stlb_e, int stlb_w,
+               int pwc_e, int mem_mb, bool thp)
+ : itlb(itlb_e, itlb_w), dtlb(dtlb_e, dtlb_w), stlb(stlb_e, stlb_w), pwc_entries(pwc_e), mem(mem_mb, thp),
+   walk_cache(0), walks(0), walks_2m(0), pwc_hits(0), walk_refs(0), walk_misses(0), walk_latency(0), walk_cycles(0)
+{
+}
+
+bool mmuSim::pwc_lookup(size_t key)
+{
+  for (std::list<size_t>::iterator it = pwc.begin(); it != pwc.end(); it++)
+  {
+    if (*it == key)
+    {
+      pwc.splice(pwc.end(), pwc, it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void mmuSim::pwc_insert(size_t key)
+{
+  if (pwc_entries <= 0)
+    return;
+  if ((int) pwc.size() >= pwc_entries)
+    pwc.pop_front();
+  pwc.push_back(key);
+}
+
+//PWC key of the level-`level` entry that translates vaddr
+static inline size_t PWC_KEY(int level, size_t vaddr)
+{
+  return ((size_t) level << 60) | (vaddr >> (PAGE_4K_BITS + PT_INDEX_BITS * (PT_LEVELS - 1 - level)));
+}
+
+size_t mmuSim::walk(size_t vaddr, size_t pc, bool ifetch, bool & huge)
+{
+  size_t pfn = mem.map(vaddr, ifetch, huge);
+  int leaf = huge ? PT_LEVELS - 2 : PT_LEVELS - 1;
+  walks++;
+  if (huge)
+    walks_2m++;
+
+  //resume below the deepest non-leaf entry cached in the PWC
+  int start = 0;
+  for (int level = leaf - 1; level >= 0; level--)
+  {
+    if (pwc_lookup(PWC_KEY(level, vaddr)))
+    {
+      pwc_hits++;
+      start = level + 1;
+      break;
+    }
+  }
+
+  for (int level = start; level <= leaf; level++)
+  {
+    size_t pte = mem.pte_addr(level, vaddr);
+    if (level < leaf)
+      pwc_insert(PWC_KEY(level, vaddr));
+    if (!walk_cache)
+      continue;
+    long miss = walk_cache->get_miss_cnt();
+    walk_cache->access(pte, pc, false);
+    walk_refs++;
+    walk_misses += walk_cache->get_miss_cnt() - miss;
+    if (walk_cache->timing)
+      walk_latency += walk_cache->last_latency;
+  }
+  walk_cycles += walk_latency;
+  return pfn;
+}
+
+size_t mmuSim::translate(size_t vaddr, size_t pc, bool ifetch)
+{
+  tlbArray & l1 = ifetch ? itlb : dtlb;
+  size_t pfn;
+  bool huge;
+  walk_latency = 0;
+  if (!l1.lookup(vaddr, pfn, huge))
+  {
+    if (!stlb.lookup(vaddr, pfn, huge))
+    {
+      pfn = walk(vaddr, pc, ifetch, huge);
+      stlb.insert(vaddr, pfn, huge);
+    }
+    l1.insert(vaddr, pfn, huge);
+  }
+  int bits = huge ? PAGE_2M_BITS : PAGE_4K_BITS;
+  return (pfn << bits) | (vaddr & ((1UL << bits) - 1));
+}
+
+static void report_tlb(std::ostream & out, const std::string & name, const tlbArray & t, long instrs)
+{
+  out << name << " ACCESSES: " << t.accesses << std::endl;
+  out << name << " MISSES: " << t.misses << std::endl;
+  out << name << " MISS RATE : " << (t.accesses ? (double) t.misses / (double) t.accesses : 0.0) << std::endl;
+  out << name << " MPKI : " << (instrs ? 1000.0 * (double) t.misses / (double) instrs : 0.0) << std::endl;
+}
+
+void mmuSim::report(std::ostream & out, long instrs)
+{
+  report_tlb(out, "ITLB", itlb, instrs);
+  report_tlb(out, "DTLB", dtlb, instrs);
+  report_tlb(out, "STLB", stlb, instrs);
+  out << "PAGE WALKS: " << walks << " (2MB pages: " << walks_2m << ")" << std::endl;
+  out << "PWC HITS: " << pwc_hits << std::endl;
+  out << "WALK L2 REFERENCES: " << walk_refs << std::endl;
+  out << "WALK L2 MISSES: " << walk_misses << std::endl;
+  out << "WALK L2 REFERENCES PER WALK : " << (walks ? (double) walk_refs / (double) walks : 0.0) << std::endl;
+  if (walk_cache && walk_cache->get_access_cnt())
+    out << "WALK SHARE OF L2 ACCESSES : " << (double) walk_refs / (double) walk_cache->get_access_cnt() << std::endl;
+  if (walk_cycles)
+    out << "WALK CYCLES: " << walk_cycles << std::endl;
+  out << "PAGES TOUCHED: " << mem.pages_4k << " x 4KB, " << mem.pages_2m << " x 2MB, " << mem.table_pages << " page-table pages" << std::endl;
+}
@@ -0,0 +1,124 @@
+#ifndef _TLB_SIM_H_
+#define _TLB_SIM_H_
+
+#include <list>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <unordered_map>
+#include "cacheSim.h"
+
+//Address translation in front of a cacheSim hierarchy
+//
+//Virtual addresses are translated before they reach the L1s: an L1 TLB (I or D) is
+//probed first, then the shared L2 TLB, and a miss in both walks the 4-level x86-64 page
+//table. The walk skips the levels whose entries hit in the page-walk cache (PWC) and
+//sends one read per remaining level to walk_cache (the L2), so walks compete with demand
+//traffic there. Every TLB holds 4 KB and 2 MB translations (probed for both sizes).
+//
+//Physical memory is handed out on first touch in 2 MB regions: a region either backs one
+//2 MB page or is split into 4 KB frames (data and page-table pages). Region numbers and
+//frames within a region are scrambled (odd-multiplier bijection), so physical set indices
+//do not follow virtual contiguity. With thp, a 2 MB virtual region first touched by a data
+//access is mapped with a 2 MB page; code is always mapped with 4 KB pages.
+
+#define PAGE_4K_BITS  12
+#define PAGE_2M_BITS  21
+#define PT_LEVELS     4     //PML4, PDPT, PD, PT
+#define PT_INDEX_BITS 9
+#define PHYS_SCRAMBLE 0x9E3779B1UL
+
+struct TlbEntry
+{
+  size_t vpn;   //virtual page number in units of its page size
+  size_t pfn;   //physical frame number in units of its page size
+  bool huge;    //2 MB page
+};
+
+//set-associative LRU TLB (sets: back == MRU)
+class tlbArray
+{
+  int ways;
+  size_t set_mask;
+  std::vector< std::list<TlbEntry> > sets;
+
+  bool probe(size_t vpn, bool huge, size_t & pfn);
+
+public :
+  long accesses;
+  long misses;
+
+  tlbArray(int entries, int ways);
+
+  //translate vaddr if cached; counts an access and, if neither page size hits, a miss
+  bool lookup(size_t vaddr, size_t & pfn, bool & huge);
+  void insert(size_t vaddr, size_t pfn, bool huge);
+};
+
+//first-touch virtual -> physical allocator and page-table layout
+class physMem
+{
+  size_t num_regions;
+  size_t next_region;
+  size_t small_region;   //region 4 KB frames are taken from
+  size_t small_next;     //next frame index in small_region (512: take a new region)
+
+  std::unordered_map<size_t, size_t> regions;  //2 MB vpn -> 2 MB pfn, or SMALL_REGION
+  std::unordered_map<size_t, size_t> pages;    //4 KB vpn -> 4 KB pfn
+  std::unordered_map<size_t, size_t> tables;   //(level, vaddr prefix) -> 4 KB pfn of the table
+
+  size_t alloc_region();
+  size_t alloc_frame();
+
+public :
+  bool thp;
+  long pages_4k;
+  long pages_2m;
+  long table_pages;
+
+  physMem(int mem_mb, bool thp);
+
+  //frame of vaddr's page (allocated on first touch); huge is set for 2 MB pages
+  size_t map(size_t vaddr, bool ifetch, bool & huge);
+  //physical address of the level-`level` page-table entry that translates vaddr
+  size_t pte_addr(int level, size_t vaddr);
+};
+
+class mmuSim
+{
+  tlbArray itlb;
+  tlbArray dtlb;
+  tlbArray stlb;
+
+  int pwc_entries;
+  std::list<size_t> pwc;   //(level, vaddr prefix) keys of cached non-leaf entries, back == MRU
+
+  physMem mem;
+
+  bool pwc_lookup(size_t key);
+  void pwc_insert(size_t key);
+  size_t walk(size_t vaddr, size_t pc, bool ifetch, bool & huge);
+
+public :
+  //receives the page-table reads of the walks (NULL: walks are not simulated in the caches)
+  cacheSim * walk_cache;
+
+  long walks;
+  long walks_2m;
+  long pwc_hits;
+  long walk_refs;       //page-table reads sent to walk_cache
+  long walk_misses;     //of which missed in walk_cache
+  long walk_latency;    //cycles of the last walk (walk_cache timing model only)
+  long walk_cycles;
+
+  //entries:ways of the I/D L1 TLBs and the L2 TLB, PWC entries, physical memory in MB
+  mmuSim(int itlb_e, int itlb_w, int dtlb_e, int dtlb_w, int stlb_e, int stlb_w,
+         int pwc_e, int mem_mb, bool thp);
+
+  //physical address of vaddr; walk_latency is 0 unless this access walked with timing
+  size_t translate(size_t vaddr, size_t pc, bool ifetch);
+
+  void report(std::ostream & out, long instrs);
+};
+
+#endif
@@ -0,0 +1,133 @@
+#!/usr/bin/perl -w
+#*************************************************************
+# validateSampling.pl: compare sampled dbpSim reports (-sample 1) against the
+# full-simulation reports of the same workloads.
+#
+# For every <workload>_p0.txt.gz in the report directory, the sampled report
+# <workload><suffix>.txt.gz is read (if present) and for each cache the miss rate,
+# DBP accuracy and DBP coverage of both runs are printed together with the
+# relative error and whether the full-run value lies inside the confidence interval.
+#
+# The _p0 reports were produced with the default geometry and TCP off, e.g.
+#   pin -t obj-intel64/dbpSim.so -sample 1 -o mcf_smp.txt.gz -- <mcf command>
+#
+# Full reports without a "L2 CACHE WRITE-BACKS RECEIVED" line (including the _p0
+# reports shipped here) predate the fix that keeps blocks dirty across read hits: their
+# L1s dropped write-backs, so their L2 counts are too low. L2 rows of such reports are
+# marked "stale" and left out of the summary; regenerate the report to check them.
+#*************************************************************
+
+$dir    = ".";
+$suffix = "_smp";
+
+sub usage(){
+    print(STDERR "Usage:  '$0 [-d <report dir>] [-s <sampled suffix>]'\n");
+    print(STDERR "\t-d <dir>     : directory holding <workload>_p0.txt.gz and the sampled reports (default .)\n");
+    print(STDERR "\t-s <suffix>  : sampled report name is <workload><suffix>.txt.gz (default _smp)\n");
+    exit(1);
+}
+
+while (@ARGV) {
+    $option = shift;
+    if ($option eq "-h") {
+        usage();
+    } elsif ($option eq "-d") {
+        $dir = shift or usage();
+    } elsif ($option eq "-s") {
+        $suffix = shift or usage();
+    } else {
+        usage();
+    }
+}
+
+#report prefixes of the three caches; dbpSim names the L2 access count "L2 ACCESS COUNT"
+@caches = ("L1 I_CACHE", "L1 D_CACHE", "L2 CACHE");
+
+sub read_lines {
+    my ($file) = @_;
+    open(my $fh, "gzip -dc $file |") or die "cannot read $file\n";
+    my @lines = <$fh>;
+    close($fh);
+    return @lines;
+}
+
+#full run: {cache}{miss_rate|accuracy|coverage}, computed from the event counts
+sub parse_full {
+    my @lines = read_lines($_[0]);
+    my %r;
+    foreach my $c (@caches) {
+        my ($acc, $miss, $dbp, $mp, $ev);
+        my $acc_name = ($c eq "L2 CACHE") ? "L2(?: CACHE)?" : "\Q$c\E";
+        foreach (@lines) {
+            $acc  = $1 if (/^$acc_name ACCESS COUNT:\s*(\d+)/);
+            $miss = $1 if (/^\Q$c\E MISS COUNT:\s*(\d+)/);
+            $dbp  = $1 if (/^\Q$c\E DEAD BLK PRED:\s*(\d+)/);
+            $mp   = $1 if (/^\Q$c\E DBP MISS_PRED:\s*(\d+)/);
+            $ev   = $1 if (/^\Q$c\E EVICTIONS:\s*(\d+)/);
+        }
+        $r{stale} = 1 if ($c eq "L2 CACHE" && !grep(/^L2 CACHE WRITE-BACKS RECEIVED:/, @lines));
+        next if (!defined($acc) || !defined($miss));
+        $r{$c}{miss_rate} = ($acc) ? $miss / $acc : 0;
+        if (defined($dbp) && defined($mp) && defined($ev)) {
+            $r{$c}{accuracy} = ($dbp) ? ($dbp - $mp) / $dbp : 0;
+            $r{$c}{coverage} = ($ev) ? ($dbp - $mp) / $ev : 0;
+        }
+    }
+    return %r;
+}
+
+#sampled run: {cache}{metric} = [estimate, half-width]
+sub parse_sampled {
+    my @lines = read_lines($_[0]);
+    my %r;
+    my %names = ("MISS RATE" => "miss_rate", "DBP ACCURACY" => "accuracy", "DBP COVERAGE" => "coverage");
+    foreach my $c (@caches) {
+        foreach (@lines) {
+            if (/^\Q$c\E SAMPLED (MISS RATE|DBP ACCURACY|DBP COVERAGE) :\s*(\S+) \+- (\S+)/) {
+                $r{$c}{$names{$1}} = [$2, $3];
+            }
+        }
+    }
+    return %r;
+}
+
+opendir(DIR, $dir) or die "cannot open $dir\n";
+@full_reports = sort grep { /_p0\.txt\.gz$/ } readdir(DIR);
+closedir(DIR);
+
+printf("%-12s %-11s %-10s %12s %12s %12s %8s %6s\n",
+       "WORKLOAD", "CACHE", "METRIC", "FULL", "SAMPLED", "+-CI", "ERR(%)", "IN_CI");
+
+$checked = 0;
+$inside  = 0;
+foreach $full (@full_reports) {
+    ($wl = $full) =~ s/_p0\.txt\.gz$//;
+    $sampled = "$dir/$wl$suffix.txt.gz";
+    if (! -e $sampled) {
+        print(STDERR "$wl: no sampled report $sampled, skipped\n");
+        next;
+    }
+    %f = parse_full("$dir/$full");
+    %s = parse_sampled($sampled);
+    print(STDERR "$wl: full report predates the write-back fix, L2 rows are stale\n") if ($f{stale});
+
+    foreach $c (@caches) {
+        foreach $m ("miss_rate", "accuracy", "coverage") {
+            next if (!defined($f{$c}{$m}) || !defined($s{$c}{$m}));
+            ($est, $ci) = @{$s{$c}{$m}};
+            $ref = $f{$c}{$m};
+            $err = ($ref != 0) ? 100.0 * ($est - $ref) / $ref : 0;
+            $ok  = (abs($est - $ref) <= $ci) ? "yes" : "no";
+            if ($c eq "L2 CACHE" && $f{stale}) {
+                $ok = "stale";
+            } else {
+                $checked++;
+                $inside++ if ($ok eq "yes");
+            }
+            printf("%-12s %-11s %-10s %12.6g %12.6g %12.6g %8.2f %6s\n", $wl, $c, $m, $ref, $est, $ci, $err, $ok);
+        }
+    }
+}
+
+print("\n$inside of $checked full-run values inside the sampled confidence intervals\n");
+exit(0);
@@ -0,0 +1,121 @@
+#include "wbBuffer.h"
+
+wbBuffer::wbBuffer(int n) : entries(n), writes(0), coalesced(0), lookups(0), read_hits(0), drained(0)
+{
+}
+
+bool wbBuffer::find_and_erase(size_t blk_addr)
+{
+  for (std::deque<size_t>::iterator it = fifo.begin(); it != fifo.end(); it++)
+  {
+    if (*it == blk_addr)
+    {
+      fifo.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool wbBuffer::insert(size_t blk_addr, size_t & out)
+{
+  writes++;
+  for (std::deque<size_t>::iterator it = fifo.begin(); it != fifo.end(); it++)
+  {
+    if (*it == blk_addr)
+    {
+      coalesced++;
+      return false;
+    }
+  }
+  fifo.push_back(blk_addr);
+  if ((int) fifo.size() <= entries)
+    return false;
+  out = fifo.front();
+  fifo.pop_front();
+  drained++;
+  return true;
+}
+
+bool wbBuffer::take(size_t blk_addr)
+{
+  lookups++;
+  if (!find_and_erase(blk_addr))
+    return false;
+  read_hits++;
+  return true;
+}
+
+bool wbBuffer::pop(size_t & out)
+{
+  if (fifo.empty())
+    return false;
+  out = fifo.front();
+  fifo.pop_front();
+  drained++;
+  return true;
+}
+
+void wbBuffer::report(std::ostream & out, const std::string & prefix)
+{
+  out << prefix << " WB BUFFER ENTRIES: " << entries << std::endl;
+  out << prefix << " WB BUFFER WRITES: " << writes << std::endl;
+  out << prefix << " WB BUFFER COALESCED: " << coalesced << std::endl;
+  out << prefix << " WB BUFFER COALESCE RATE : " << (writes ? (double) coalesced / (double) writes : 0.0) << std::endl;
+  out << prefix << " WB BUFFER READ HITS: " << read_hits << std::endl;
+  out << prefix << " WB BUFFER READ HIT RATE : " << (lookups ? (double) read_hits / (double) lookups : 0.0) << std::endl;
+  out << prefix << " WB BUFFER DRAINED: " << drained << " (" << fifo.size() << " pending)" << std::endl;
+}
+
+victimCache::victimCache(int n) : entries(n), inserts(0), lookups(0), rescues(0), dirty_evictions(0)
+{
+}
+
+bool victimCache::find_and_erase(size_t blk_addr, bool & dirty)
+{
+  for (std::list<VcEntry>::iterator it = blks.begin(); it != blks.end(); it++)
+  {
+    if (it->blk_addr == blk_addr)
+    {
+      dirty = it->dirty;
+      blks.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool victimCache::insert(size_t blk_addr, bool dirty, size_t & out, bool & out_dirty)
+{
+  inserts++;
+  VcEntry e;
+  e.blk_addr = blk_addr;
+  e.dirty = dirty;
+  blks.push_back(e);
+  if ((int) blks.size() <= entries)
+    return false;
+  out = blks.front().blk_addr;
+  out_dirty = blks.front().dirty;
+  blks.pop_front();
+  if (out_dirty)
+    dirty_evictions++;
+  return true;
+}
+
+bool victimCache::take(size_t blk_addr, bool & dirty)
+{
+  lookups++;
+  if (!find_and_erase(blk_addr, dirty))
+    return false;
+  rescues++;
+  return true;
+}
+
+void victimCache::report(std::ostream & out, const std::string & prefix)
+{
+  out << prefix << " VICTIM CACHE ENTRIES: " << entries << std::endl;
+  out << prefix << " VICTIM CACHE INSERTS: " << inserts << std::endl;
+  out << prefix << " VICTIM CACHE RESCUES: " << rescues << std::endl;
+  out << prefix << " VICTIM CACHE RESCUE RATE : " << (lookups ? (double) rescues / (double) lookups : 0.0) << std::endl;
+  out << prefix << " VICTIM CACHE DIRTY EVICTIONS: " << dirty_evictions << std::endl;
+}
@@ -0,0 +1,81 @@
+#ifndef _WB_BUFFER_H_
+#define _WB_BUFFER_H_
+
+#include <list>
+#include <deque>
+#include <string>
+#include <cstddef>
+#include <iostream>
+
+//Optional buffers between a cacheSim and its next level (cacheSim::wbb, cacheSim::vc)
+//
+//wbBuffer: FIFO of dirty blocks waiting to be written to the next level. A write-back
+//of a blk that is already queued coalesces into its entry; when the buffer is full the
+//oldest entry drains. A miss of the cache finds its blk in the buffer (read hit) and
+//takes it back dirty, so neither the fetch nor the pending write-back reaches the next
+//level.
+//
+//victimCache: small fully-associative LRU cache of the blocks the cache evicts (Jouppi).
+//A miss that hits in it is rescued: the blk moves back into the cache with its dirty bit
+//and no request goes to the next level. Blocks leaving the victim cache are handled like
+//the cache's own victims (write-back if dirty, or a fill of an exclusive parent).
+
+class wbBuffer
+{
+  int entries;
+  std::deque<size_t> fifo;   //blk addresses, oldest first
+
+  bool find_and_erase(size_t blk_addr);
+
+public :
+  long writes;      //write-backs received
+  long coalesced;   //of which merged into a queued entry
+  long lookups;     //misses of the cache that searched the buffer
+  long read_hits;   //of which found their blk
+  long drained;     //entries written to the next level
+
+  explicit wbBuffer(int n);
+
+  //queue a write-back; returns true if the oldest entry drains (its blk in out)
+  bool insert(size_t blk_addr, size_t & out);
+  //a miss searches the buffer; a hit removes the entry
+  bool take(size_t blk_addr);
+  //drop a blk without counting (invalidation); returns true if it was queued
+  bool remove(size_t blk_addr) { return find_and_erase(blk_addr); }
+  //drain the oldest entry (end of a run); returns false if the buffer is empty
+  bool pop(size_t & out);
+
+  void report(std::ostream & out, const std::string & prefix);
+};
+
+class victimCache
+{
+  struct VcEntry
+  {
+    size_t blk_addr;
+    bool dirty;
+  };
+  int entries;
+  std::list<VcEntry> blks;   //back == MRU
+
+  bool find_and_erase(size_t blk_addr, bool & dirty);
+
+public :
+  long inserts;           //victims received
+  long lookups;           //misses of the cache that searched it
+  long rescues;           //of which hit
+  long dirty_evictions;   //dirty blocks pushed out to the next level
+
+  explicit victimCache(int n);
+
+  //add a victim; returns true if the LRU blk is pushed out (its address and dirty bit in out, out_dirty)
+  bool insert(size_t blk_addr, bool dirty, size_t & out, bool & out_dirty);
+  //a miss searches the victim cache; a hit removes the blk and returns its dirty bit
+  bool take(size_t blk_addr, bool & dirty);
+  //drop a blk without counting (invalidation); returns true if it was cached
+  bool remove(size_t blk_addr, bool & dirty) { return find_and_erase(blk_addr, dirty); }
+
+  void report(std::ostream & out, const std::string & prefix);
+};
+
+#endif
@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# dlite-bench - time a simulation with 0, 1, 10 and 100 armed DLite data
+#		breakpoints, placed on words below the initial stack that the
+#		program never touches, so every breakpoint check is a miss
+#
+# usage: dlite-bench.sh <simulator> <program> [<program args>]
+#
+# the simulator is started in DLite (-i), which reads its commands from
+# stdin, so the program must not read stdin
+#
+
+if [ $# -lt 2 ]; then
+  echo "usage: $0 <simulator> <program> [<program args>]" >&2
+  exit 1
+fi
+
+SIM=$1
+shift
+
+for n in 0 1 10 100; do
+  cmds=""
+  i=0
+  while [ $i -lt $n ]; do
+    cmds="${cmds}dbreak $((0x7ff00000 + 64 * i)) rw
+"
+    i=$((i + 1))
+  done
+
+  start=$(date +%s%N)
+  printf '%scont\n' "$cmds" | $SIM -i "$@" > /dev/null 2>&1
+  end=$(date +%s%N)
+  echo "$n breakpoints: $(( (end - start) / 1000000 )) ms"
+done
@@ -68,6 +68,7 @@
 #include "options.h"
 #include "stats.h"
 #include "range.h"
+#include "bitmap.h"
 #include "dlite.h"
 
 /* architected state accessors, initialized by dlite_init() */
@@ -1676,6 +1677,160 @@ static struct dlite_break_t *dlite_bps = NULL;
 /* unique id of next breakpoint */
 static int break_id = 1;
 
+/*
+ * breakpoint page index: address breakpoints are also recorded, per page they
+ * touch, as one bitmap per access class with a bit for each byte of the page;
+ * __check_break() scans the breakpoint list only when the next PC or the
+ * accessed address hits a set bit, instead of on every instruction
+ */
+
+/* number of entries in the page index hash table (must be power-of-two) */
+#define BREAK_PTAB_SIZE		1024
+
+/* address breakpoints spanning more pages than this are not indexed */
+#define BREAK_MAX_PAGES		256
+
+/* page index hash table set and tag of address ADDR */
+#define BREAK_PTAB_TAG(ADDR)	((ADDR) >> MD_LOG_PAGE_SIZE)
+#define BREAK_PTAB_SET(ADDR)	(BREAK_PTAB_TAG(ADDR) & (BREAK_PTAB_SIZE - 1))
+
+/* one indexed page, bit I of a map is set if some breakpoint of that class
+   covers byte I of the page */
+struct break_page_t {
+  struct break_page_t *next;		/* next page in this bucket */
+  md_addr_t tag;			/* virtual page number */
+  BITMAP_TYPE(MD_PAGE_SIZE, exec);	/* execute breakpoints */
+  BITMAP_TYPE(MD_PAGE_SIZE, read);	/* read breakpoints */
+  BITMAP_TYPE(MD_PAGE_SIZE, write);	/* write breakpoints */
+};
+
+/* page index, hashed by virtual page number */
+static struct break_page_t *break_ptab[BREAK_PTAB_SIZE];
+
+/* non-zero if the page index no longer matches the breakpoint list */
+static int break_ptab_stale = FALSE;
+
+/* non-zero if some breakpoint is not indexed (instruction or cycle count
+   breakpoints, wide address ranges), the list is then always scanned */
+static int break_scan_all = FALSE;
+
+/* find the index of the page holding ADDR, returns NULL if not indexed */
+static struct break_page_t *
+break_page(md_addr_t addr)			/* address to look up */
+{
+  struct break_page_t *pg;
+
+  for (pg=break_ptab[BREAK_PTAB_SET(addr)]; pg != NULL; pg=pg->next)
+    {
+      if (pg->tag == BREAK_PTAB_TAG(addr))
+	return pg;
+    }
+  return NULL;
+}
+
+/* non-zero if a breakpoint of class CLASS may cover address ADDR */
+static int
+break_indexed_p(int class,			/* break class, one ACCESS_* */
+		md_addr_t addr)			/* address to check */
+{
+  struct break_page_t *pg = break_page(addr);
+
+  if (!pg)
+    return FALSE;
+  switch (class)
+    {
+    case ACCESS_EXEC:
+      return BITMAP_SET_P(pg->exec, 0, addr & (MD_PAGE_SIZE - 1));
+    case ACCESS_READ:
+      return BITMAP_SET_P(pg->read, 0, addr & (MD_PAGE_SIZE - 1));
+    case ACCESS_WRITE:
+      return BITMAP_SET_P(pg->write, 0, addr & (MD_PAGE_SIZE - 1));
+    default:
+      panic("bogus access class");
+    }
+}
+
+/* add the bytes of address breakpoint BP to the page index */
+static void
+break_index_add(struct dlite_break_t *bp)	/* breakpoint to index */
+{
+  md_addr_t addr, start, end;
+  struct break_page_t *pg;
+  unsigned int i;
+
+  /* an empty range never matches */
+  if (bp->range.start.pos > bp->range.end.pos)
+    return;
+
+  /* the range may extend past the top of the address space */
+  start = (md_addr_t)bp->range.start.pos;
+  if (bp->range.end.pos > (counter_t)(md_addr_t)-1)
+    end = (md_addr_t)-1;
+  else
+    end = (md_addr_t)bp->range.end.pos;
+
+  if (BREAK_PTAB_TAG(end) - BREAK_PTAB_TAG(start) >= BREAK_MAX_PAGES)
+    {
+      break_scan_all = TRUE;
+      return;
+    }
+
+  for (addr=start; ; addr++)
+    {
+      pg = break_page(addr);
+      if (!pg)
+	{
+	  pg = calloc(1, sizeof(struct break_page_t));
+	  if (!pg)
+	    fatal("out of virtual memory");
+	  pg->tag = BREAK_PTAB_TAG(addr);
+	  pg->next = break_ptab[BREAK_PTAB_SET(addr)];
+	  break_ptab[BREAK_PTAB_SET(addr)] = pg;
+	}
+
+      i = addr & (MD_PAGE_SIZE - 1);
+      if (bp->class & ACCESS_EXEC)
+	BITMAP_SET(pg->exec, 0, i);
+      if (bp->class & ACCESS_READ)
+	BITMAP_SET(pg->read, 0, i);
+      if (bp->class & ACCESS_WRITE)
+	BITMAP_SET(pg->write, 0, i);
+
+      if (addr == end)
+	break;
+    }
+}
+
+/* rebuild the page index from the breakpoint list */
+static void
+break_index_build(void)
+{
+  int i;
+  struct dlite_break_t *bp;
+  struct break_page_t *pg, *next;
+
+  for (i=0; i < BREAK_PTAB_SIZE; i++)
+    {
+      for (pg=break_ptab[i]; pg != NULL; pg=next)
+	{
+	  next = pg->next;
+	  free(pg);
+	}
+      break_ptab[i] = NULL;
+    }
+
+  break_scan_all = FALSE;
+  for (bp=dlite_bps; bp != NULL; bp=bp->next)
+    {
+      if (bp->range.start.ptype == pt_addr)
+	break_index_add(bp);
+      else
+	break_scan_all = TRUE;
+    }
+
+  break_ptab_stale = FALSE;
+}
+
 /* return breakpoint class as a string */
 static char *					/* breakpoint class string */
 bp_class_str(int class)				/* breakpoint class mask */
@@ -1716,6 +1871,7 @@ set_break(int class,				/* break class, use ACCESS_* */
 
   bp->next = dlite_bps;
   dlite_bps = bp;
+  break_ptab_stale = TRUE;
 
   fprintf(stdout, "breakpoint #%d set @ ", bp->id);
   range_print_range(&bp->range, stdout);
@@ -1762,6 +1918,7 @@ delete_break(int id)				/* id of brkpnt to delete */
 
   bp->next = NULL;
   free(bp);
+  break_ptab_stale = TRUE;
 
   if (!dlite_bps)
     {
@@ -1799,6 +1956,19 @@ __check_break(md_addr_t next_PC,		/* address of next inst */
     }
   /* else, check for a breakpoint */
 
+  if (break_ptab_stale)
+    break_index_build();
+
+  /* nothing indexed here, no need to scan the breakpoint list */
+  if (!break_scan_all
+      && !break_indexed_p(ACCESS_EXEC, next_PC)
+      && !((access & ACCESS_READ) && break_indexed_p(ACCESS_READ, addr))
+      && !((access & ACCESS_WRITE) && break_indexed_p(ACCESS_WRITE, addr)))
+    {
+      break_access = /* no break */0;
+      return FALSE;
+    }
+
   for (bp=dlite_bps; bp != NULL; bp=bp->next)
     {
       switch (bp->range.start.ptype)
@@ -6,13 +6,4 @@ extern counter_t sim_transitive_ineff;
 extern counter_t sim_mem_nmod_wr;
 extern counter_t sim_mem_uref_wr;
 
-extern md_addr_t _mem_load_addr_0;
-extern md_addr_t _mem_load_addr_1;
-
-extern md_addr_t _mem_store_addr_0;
-extern md_addr_t _mem_store_addr_1;
-
-extern word_t _mem_store_new_word_0;
-extern word_t _mem_store_new_word_1;
-extern word_t _mem_store_old_word_0;
-extern word_t _mem_store_old_word_1;
+extern counter_t sim_ineff_worklist_peak;
@@ -5,29 +5,54 @@
 *
 */
 
-#include <map>
+#include <queue>
 #include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <iterator>
 #include <list>
+#include <deque>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <system_error>
 #include "machine.h"
 #include "regs.h"
 #include "ir_counters.h"
+#include "ir_detector.h"
+extern "C" {
+#include "loader.h"
+#include "symbol.h"
+}
 
 /* IDENTIFYING INSTRUCTIONS */
 
+//counters of ineffectual instances (ir_counters.h); the simulators register them as statistics
+counter_t sim_reg_nmod_wr = 0;
+counter_t sim_reg_uref_wr = 0;
+counter_t sim_inef_br = 0;
+counter_t sim_transitive_ineff = 0;
+counter_t sim_mem_nmod_wr = 0;
+counter_t sim_mem_uref_wr = 0;
+counter_t sim_ineff_worklist_peak = 0;
+
+//the K-th output register of an instruction, before (PREG) and after (REG) it executes;
+//the words are those of regs_t at the register's dependence number (see IR_SAVE_REG)
+static inline sfloat_t _word_f(const sword_t * w) { sfloat_t f; memcpy(&f, w, sizeof(f)); return f; }
+static inline dfloat_t _word_d(const sword_t * w) { dfloat_t d; memcpy(&d, w, sizeof(d)); return d; }
+
 //ONE way to read an integer register
-#define READ_I_REG(N)		(regfile->regs_R[N])
-#define READ_I_PREG(N)		(p_regifle->regs_R[N])
+#define READ_I_REG(K)		(ev.out_post[K].w[0])
+#define READ_I_PREG(K)		(ev.out_pre[K].w[0])
 
 //TWO ways to read a floating point register
-#define READ_F_REG(N)		(regfile->regs_F.f[(N)])
-#define READ_F_PREG(N)		(p_regifle->regs_F.f[(N)])
-#define READ_D_REG(N)		(regfile->regs_F.d[(N) >> 1])
-#define READ_D_PREG(N)		(p_regifle->regs_F.d[(N) >> 1])
+#define READ_F_REG(K)		(_word_f(ev.out_post[K].w))
+#define READ_F_PREG(K)		(_word_f(ev.out_pre[K].w))
+#define READ_D_REG(K)		(_word_d(ev.out_post[K].w))
+#define READ_D_PREG(K)		(_word_d(ev.out_pre[K].w))
 
 //operand rename table entry; point to the latest producer
 //an entry is "reset" on when a new value is written to reg/memory
@@ -44,37 +69,42 @@ struct ort_entry
   ort_entry() : valid(false), referenced(false), producer_idx(0), ort_pair(0) {} 
 };
 
-//dynamic instruction window FIFO entry
-struct fifo_entry
+//dynamic instruction window, split by access pattern into parallel arrays indexed by
+//window slot; only branches and stores with a second address keep more, in FIFO side queues
+//  w_links   : producers and consumer count; followed at random through src_idx
+//  w_mem_out : first ORT memory location (0 if none); checked when a producer loses its last consumer
+//  w_reg_out : ORT output registers; used for ORT invalidation upon window exit
+struct window_links
 {
-  bool valid;
-
-  //ORT output registers / memory locations; used for ORT invalidation upon window exit
-  unsigned reg_out1;
-  unsigned reg_out2;
-  md_addr_t mem_out1;
-  md_addr_t mem_out2;
-  
   //keep track of producer entries inside the FIFO; used for follow transitively ineffectual instructions
   //-1 if it is not using the source operand 
-  int src_idx1;
-  int src_idx2;
-  int src_idx3;
+  int32_t src_idx[3];
   //store number of this instruction's consumers that are "effectual"; if negative, the entry is already accounted for
   //transitive write
-  int consumer_count;
+  int32_t consumer_count;
+};
+
+struct window_reg_out
+{
+  unsigned char reg_out1;
+  unsigned char reg_out2;
+};
+static_assert(MD_TOTAL_REGS <= 256, "window_reg_out holds register indices in a byte");
 
+//conditional branch in the window (br_queue); seq is its position in the dynamic instruction stream
+struct window_branch
+{
+  size_t seq;
+  md_addr_t branch_pc;
   //if chk_ineff_br == true, this entry may be later determined to be ineffectual
   bool chk_ineff_br;
-  md_addr_t branch_pc;
+};
 
-  fifo_entry() : valid(false), src_idx1(0), src_idx2(0), src_idx3(0), consumer_count(0), chk_ineff_br(false), branch_pc(0)
-  {
-    reg_out1 = 0;
-    reg_out2 = 0;
-    mem_out1 = 0;
-    mem_out2 = 0;
-  }
+//second ORT memory location of a store in the window (mem2_queue)
+struct window_mem_out2
+{
+  size_t seq;
+  md_addr_t mem_out2;
 };
 
 //branch target buffer; keep track of each branch's tgt address, flag whether if its target has changed
@@ -88,53 +118,242 @@ struct btb_entry
   btb_entry(md_addr_t n_pc) : tgt_addr(n_pc), const_tgt(true), valid_cnt(1) {}
 };
 
-//ORT tables; ld/st instructions write to ort_memory
-std::unordered_map<md_addr_t, ort_entry> ort_memory; 
+//ORT tables; ld/st instructions write to the memory ORT (ort_ptab below)
 std::vector<ort_entry> ort_regfile(MD_TOTAL_REGS);
 
+//memory ORT: a shadow of the simulated memory with one entry per byte address, laid out
+//like mem_t's page table (memory.h): a hashed page directory of lazily allocated dense
+//pages. A page is reclaimed (onto ort_free_pages) as soon as none of its entries is valid,
+//i.e. all the stores that produced them have left the instruction window.
+#define ORT_LOG_PAGE_SIZE	10
+#define ORT_PAGE_SIZE		(1 << ORT_LOG_PAGE_SIZE)
+#define ORT_PTAB_SIZE		(16*1024)
+#define ORT_LOG_PTAB_SIZE	14
+
+#define ORT_PTAB_SET(ADDR)	(((ADDR) >> ORT_LOG_PAGE_SIZE) & (ORT_PTAB_SIZE - 1))
+#define ORT_PTAB_TAG(ADDR)	((ADDR) >> (ORT_LOG_PAGE_SIZE + ORT_LOG_PTAB_SIZE))
+#define ORT_OFFSET(ADDR)	((ADDR) & (ORT_PAGE_SIZE - 1))
+
+struct ort_page
+{
+  ort_page * next;	//next page in this bucket (or in the free list)
+  md_addr_t tag;
+  unsigned live;	//number of valid entries
+  ort_entry entries[ORT_PAGE_SIZE];
+};
+
+ort_page * ort_ptab[ORT_PTAB_SIZE];
+ort_page * ort_free_pages;
+
 //conditional branch history buffer
 std::unordered_map<md_addr_t, btb_entry> btb_map; 
 
-//map to keep track of how many times instructions at a pc has been removed
-std::map<md_addr_t, unsigned> removed_instr_map;
+//profile of how many times instructions at a pc have been found ineffectual, per kind:
+//open-addressing hash table (linear probing, power-of-two size, at most half full);
+//pc 0 marks an empty slot
+#define PC_PROFILE_INIT 4096
+struct pc_profile_entry
+{
+  md_addr_t pc;
+  unsigned count[IR_NUM_KINDS];
+};
+std::vector<pc_profile_entry> pc_profile(PC_PROFILE_INIT, pc_profile_entry());
+size_t pc_profile_used = 0;
 
 //the instruction window is implemented as a circular FIFO
-//vector size is kept at the initial size (w_size) during simulation
-std::vector<fifo_entry> instr_window;
+//vector sizes are kept at the initial size (w_size) during simulation
+std::vector<window_links> w_links;
+std::vector<md_addr_t> w_mem_out;
+std::vector<window_reg_out> w_reg_out;
 size_t fifo_head;
 size_t fifo_mid;
 size_t w_instr_cnt;
 
+//side queues in window order; instructions processed so far (w_seq) order their entries.
+//br_mid is the first branch not yet past the middle of the window
+std::deque<window_branch> br_queue;
+std::deque<window_mem_out2> mem2_queue;
+size_t br_mid;
+size_t w_seq;
+
+//pc of each window slot; only kept (sized w_size) when unreferenced and transitive
+//removals are profiled, as those are found after their instruction has entered the window
+std::vector<md_addr_t> w_pc;
+
+//worklist of window slots for _decrement_consumer; kept across calls so its storage is reused
+#define DC_STACK_INIT 4096
+std::vector<int32_t> dc_stack;
+
+inline size_t _pc_hash(md_addr_t pc)
+{
+   //instructions are 8-byte aligned; Fibonacci hashing spreads neighbouring pcs
+   return (size_t) (((uint32_t) (pc >> 3)) * 0x9E3779B1u);
+}
+
+void _profile_grow()
+{
+   std::vector<pc_profile_entry> old(2 * pc_profile.size(), pc_profile_entry());
+   old.swap(pc_profile);
+   size_t mask = pc_profile.size() - 1;
+   for (size_t j = 0; j < old.size(); j++) {
+      if (old[j].pc == 0)
+         continue;
+      size_t i = _pc_hash(old[j].pc) & mask;
+      while (pc_profile[i].pc != 0)
+         i = (i + 1) & mask;
+      pc_profile[i] = old[j];
+   }
+}
+
+//count one ineffectual instance of the instruction at pc
+void _profile_add(md_addr_t pc, int kind)
+{
+   size_t mask = pc_profile.size() - 1;
+   size_t i = _pc_hash(pc) & mask;
+   while (pc_profile[i].pc != pc) {
+      if (pc_profile[i].pc == 0) {
+         if (2 * (pc_profile_used + 1) > pc_profile.size()) {
+            _profile_grow();
+            mask = pc_profile.size() - 1;
+            i = _pc_hash(pc) & mask;
+            continue;
+         }
+         pc_profile[i].pc = pc;
+         pc_profile_used++;
+         break;
+      }
+      i = (i + 1) & mask;
+   }
+   pc_profile[i].count[kind]++;
+}
+
+//count of an entry for ir_detector_top; IR_NUM_KINDS: removed on entry or as a branch
+unsigned _profile_count(const pc_profile_entry & e, int kind)
+{
+   if (kind < IR_NUM_KINDS)
+      return e.count[kind];
+   return e.count[IR_NMOD_REG] + e.count[IR_NMOD_MEM] + e.count[IR_BRANCH];
+}
+
 //circular FIFO ptr increment routine
 size_t p_incr_fifo_ptr(size_t & idx)
 {
    size_t retval = idx;
-   if(idx < instr_window.size() - 1)
+   if(idx < w_links.size() - 1)
      idx += 1;
    else
      idx = 0;
    return retval; 
 }
 
-extern "C" void ir_detector_setup(size_t w_size)
+/*
+ * memory ORT page lookup; NULL if the page of addr is not allocated and alloc is false
+ */
+ort_page * _ort_mem_page(md_addr_t addr, bool alloc)
+{
+  ort_page ** bucket = &ort_ptab[ORT_PTAB_SET(addr)];
+  ort_page * prev = NULL;
+  for (ort_page * pg = *bucket; pg != NULL; prev = pg, pg = pg->next)
+  {
+    if (pg->tag == ORT_PTAB_TAG(addr))
+    {
+      //move this page to the head of the bucket list
+      if (prev)
+      {
+        prev->next = pg->next;
+        pg->next = *bucket;
+        *bucket = pg;
+      }
+      return pg;
+    }
+  }
+  if (!alloc)
+    return NULL;
+
+  ort_page * pg = ort_free_pages;
+  if (pg)
+  {
+    ort_free_pages = pg->next;
+    std::fill(pg->entries, pg->entries + ORT_PAGE_SIZE, ort_entry());
+  }
+  else
+    pg = new ort_page;
+  pg->tag = ORT_PTAB_TAG(addr);
+  pg->live = 0;
+  pg->next = *bucket;
+  *bucket = pg;
+  return pg;
+}
+
+//valid memory ORT entry of addr, or NULL
+ort_entry * _ort_mem_valid(md_addr_t addr)
+{
+  ort_page * pg = _ort_mem_page(addr, false);
+  if (!pg || !pg->entries[ORT_OFFSET(addr)].valid)
+    return NULL;
+  return &pg->entries[ORT_OFFSET(addr)];
+}
+
+//producer of the valid memory ORT entry of addr (0 if there is none); an entry whose
+//producer left the window no longer names a window slot
+size_t _ort_mem_producer(md_addr_t addr)
+{
+  ort_entry * e = _ort_mem_valid(addr);
+  return e ? e->producer_idx : 0;
+}
+
+//invalidate the memory ORT entry of addr if idx still produces it; reclaims the page once it holds no valid entry
+void _ort_mem_release(md_addr_t addr, size_t idx)
+{
+  ort_page * pg = _ort_mem_page(addr, false);
+  if (!pg || !pg->entries[ORT_OFFSET(addr)].valid || pg->entries[ORT_OFFSET(addr)].producer_idx != idx)
+    return;
+  pg->entries[ORT_OFFSET(addr)].valid = false;
+  if (--pg->live > 0)
+    return;
+
+  //the lookup above moved the page to the head of its bucket
+  ort_ptab[ORT_PTAB_SET(addr)] = pg->next;
+  pg->next = ort_free_pages;
+  ort_free_pages = pg;
+}
+
+void _ring_start(size_t ring_size);
+
+extern "C" void ir_detector_setup(size_t w_size, size_t ring_size, int profile_slots)
 {
-  instr_window.resize(w_size);
+  w_links.assign(w_size, window_links());
+  w_mem_out.assign(w_size, 0);
+  w_reg_out.assign(w_size, window_reg_out());
+  if (profile_slots)
+    w_pc.assign(w_size, 0);
+  else
+    w_pc.clear();
   fifo_head = 0;
   fifo_mid = w_size / 2;
   w_instr_cnt = 0;
+  br_queue.clear();
+  mem2_queue.clear();
+  br_mid = 0;
+  w_seq = 0;
+  dc_stack.clear();
+  dc_stack.reserve(DC_STACK_INIT);
+  if (ring_size)
+    _ring_start(ring_size);
 }
 
 /*
  *  non-modifying register write checks
  */
-bool _nmod_check(bool is_float, regs_t * regfile, regs_t * p_regifle, const int * r_out)
+bool _nmod_check(bool is_float, const ir_event & ev)
 {
+  const unsigned char * r_out = ev.r_out;
   if (is_float)
   {
-     if (r_out[0] != DNA && (READ_F_REG(r_out[0]) == READ_F_REG(r_out[0]) && READ_D_REG(r_out[0]) == READ_D_REG(r_out[0]))) {
+     if (r_out[0] != DNA && (READ_F_REG(0) == READ_F_PREG(0) && READ_D_REG(0) == READ_D_PREG(0))) {
        //if instruction is writing to 2 registers, both of them have to be non-modifying
        if (r_out[1] != DNA) {
-          if (READ_F_REG(r_out[1]) == READ_F_REG(r_out[1]) && READ_D_REG(r_out[1]) == READ_D_REG(r_out[1])){
+          if (READ_F_REG(1) == READ_F_PREG(1) && READ_D_REG(1) == READ_D_PREG(1)){
             return true;
           }
        } else {
@@ -145,11 +364,11 @@ bool _nmod_check(bool is_float, regs_t * regfile, regs_t * p_regifle, const int
   else
   {
      //non-modifying write check on REG_0: if matched, instr selected for removal as it enters FIFO
-     if (r_out[0] != DNA && (READ_I_REG(r_out[0]) == READ_I_PREG(r_out[0])))
+     if (r_out[0] != DNA && (READ_I_REG(0) == READ_I_PREG(0)))
      {
        //if instruction is writing to 2 registers, both of them have to be non-modifying
        if (r_out[1] != DNA) {
-          if (READ_I_REG(r_out[1]) == READ_I_PREG(r_out[1])) {
+          if (READ_I_REG(1) == READ_I_PREG(1)) {
             return true;
           }
        } else {
@@ -163,13 +382,13 @@ bool _nmod_check(bool is_float, regs_t * regfile, regs_t * p_regifle, const int
 /*
  *  non-modifying memory checks
  */
-bool _nmod_check_mem()
+bool _nmod_check_mem(const ir_event & ev)
 {
-  if (_mem_store_addr_0 != 0 && (_mem_store_new_word_0 == _mem_store_old_word_0))
+  if (ev.store_addr[0] != 0 && (ev.store_new[0] == ev.store_old[0]))
   {
        //if instruction is writing to two addresses, both of them have to be non-modifying
-     if (_mem_store_addr_1 != 0) {
-        if (_mem_store_new_word_1 == _mem_store_old_word_1) {
+     if (ev.store_addr[1] != 0) {
+        if (ev.store_new[1] == ev.store_old[1]) {
           return true;
         }
      } else {
@@ -179,34 +398,46 @@ bool _nmod_check_mem()
   return false;
 }
 
+//push the valid producer slots of an instruction, last source first so they pop in source order
+static inline void _dc_push(const int32_t p_indices[3])
+{
+   for (int i = 2; i >= 0; i--)
+     if (p_indices[i] > 0)
+       dc_stack.push_back(p_indices[i]);
+   if ((counter_t) dc_stack.size() > sim_ineff_worklist_peak)
+     sim_ineff_worklist_peak = (counter_t) dc_stack.size();
+}
+
 /*
- * Recursively remove instructions that are producing values for ineffectual instructions
+ * Remove instructions that are producing values for ineffectual instructions, following
+ * producer chains depth-first with an explicit worklist (chains can be as long as the
+ * window). A producer's sources are pushed only when its consumer count drops to 0,
+ * so each producer is expanded at most once per call.
  */
-void _decrement_consumer(int p_indices[3])
+void _decrement_consumer(const int32_t p_indices[3])
 {
    size_t i_idx; 
-   for (int i =0; i < 3; i++) {
-     if (p_indices[i] > 0) {
-         i_idx = (size_t) p_indices[i];
-         assert(instr_window[i_idx].valid);
-         if (instr_window[i_idx].consumer_count > 1)
-            instr_window[i_idx].consumer_count -= 1;
-         else if (instr_window[i_idx].consumer_count == 1) {
-            instr_window[i_idx].consumer_count = 0;
-
-            //If this instruction is not current producer of any ORT table entry, recurse on its prodcuer
-            //because no further instructions will become its consumer
-            if (ort_regfile[instr_window[i_idx].reg_out1].producer_idx != i_idx
-             && ort_regfile[instr_window[i_idx].reg_out2].producer_idx != i_idx
-             && ort_memory[instr_window[i_idx].mem_out1].producer_idx != i_idx
-             && ort_memory[instr_window[i_idx].mem_out1].producer_idx != i_idx
-            ) {
-               int producers[3] = {instr_window[i_idx].src_idx1,
-                                   instr_window[i_idx].src_idx2,
-                                   instr_window[i_idx].src_idx3};
-               _decrement_consumer(producers);
-            }
-         }
+   dc_stack.clear();
+   _dc_push(p_indices);
+   while (!dc_stack.empty()) {
+     i_idx = (size_t) dc_stack.back();
+     dc_stack.pop_back();
+     //slots are filled in order; all of them once the window is full
+     assert(i_idx < w_instr_cnt);
+     window_links & link = w_links[i_idx];
+     if (link.consumer_count > 1)
+        link.consumer_count -= 1;
+     else if (link.consumer_count == 1) {
+        link.consumer_count = 0;
+
+        //If this instruction is not current producer of any ORT table entry, continue with its producers
+        //because no further instructions will become its consumer
+        if (ort_regfile[w_reg_out[i_idx].reg_out1].producer_idx != i_idx
+         && ort_regfile[w_reg_out[i_idx].reg_out2].producer_idx != i_idx
+         && _ort_mem_producer(w_mem_out[i_idx]) != i_idx
+        ) {
+           _dc_push(link.src_idx);
+        }
      }
    }
 }
@@ -214,44 +445,43 @@ void _decrement_consumer(int p_indices[3])
 /*
  * Src reference update; tag instructions that produce the source operands in the window
  */
-void _ref_update(const int * r_in)
+void _ref_update(const ir_event & ev)
 {
+  const unsigned char * r_in = ev.r_in;
   for(int i=0; i<3; i++)
   {
     if(r_in[i] != DNA) {
       ort_regfile[r_in[i]].referenced = true;
-      instr_window[ort_regfile[r_in[i]].producer_idx].consumer_count += 1;
+      w_links[ort_regfile[r_in[i]].producer_idx].consumer_count += 1;
     }
   }
   //check if the matching ORT entry exisits in the table and it is valid before tagging its reference
-  if ((ort_memory.find(_mem_load_addr_0) != ort_memory.end()) && ort_memory[_mem_load_addr_0].valid  &&
-      _mem_load_addr_0 != 0) {
-     ort_memory[_mem_load_addr_0].referenced = true;
-     instr_window[ort_memory[_mem_load_addr_0].producer_idx].consumer_count += 1;
+  ort_entry * ld;
+  if (ev.load_addr[0] != 0 && (ld = _ort_mem_valid(ev.load_addr[0]))) {
+     ld->referenced = true;
+     w_links[ld->producer_idx].consumer_count += 1;
   }
-  if ((ort_memory.find(_mem_load_addr_1) != ort_memory.end()) && ort_memory[_mem_load_addr_1].valid  &&
-      _mem_load_addr_1 != 0) {
-     ort_memory[_mem_load_addr_1].referenced = true;
-     instr_window[ort_memory[_mem_load_addr_1].producer_idx].consumer_count += 1;
+  if (ev.load_addr[1] != 0 && (ld = _ort_mem_valid(ev.load_addr[1]))) {
+     ld->referenced = true;
+     w_links[ld->producer_idx].consumer_count += 1;
   }
 }
 
 /*
 * check references in ORT reg table, and check if the current producer is unused
 */
-void _uref_check(const int * r_out)
+void _uref_check(const unsigned char * r_out)
 {
   if (r_out[0] != DNA)
   {
     //check if the previous producer was ever referenced
     if (ort_regfile[r_out[0]].valid && !ort_regfile[r_out[0]].referenced && ort_regfile[r_out[0]].ort_pair == DNA ) {
       sim_reg_uref_wr++;
+      if (!w_pc.empty())
+        _profile_add(w_pc[ort_regfile[r_out[0]].producer_idx], IR_UREF);
 
       //check if its source producers can be removed as well - transitively ineffectual instructions
-      int producers[3] = {instr_window[ort_regfile[r_out[0]].producer_idx].src_idx1,
-                          instr_window[ort_regfile[r_out[0]].producer_idx].src_idx2,
-                          instr_window[ort_regfile[r_out[0]].producer_idx].src_idx3};
-      _decrement_consumer(producers);
+      _decrement_consumer(w_links[ort_regfile[r_out[0]].producer_idx].src_idx);
     }
 
     //update regfile ORT
@@ -265,12 +495,11 @@ void _uref_check(const int * r_out)
     //check if the previous producer was ever referenced
     if (ort_regfile[r_out[1]].valid && !ort_regfile[r_out[1]].referenced && ort_regfile[r_out[1]].ort_pair == DNA ) {
       sim_reg_uref_wr++;
+      if (!w_pc.empty())
+        _profile_add(w_pc[ort_regfile[r_out[1]].producer_idx], IR_UREF);
 
       //check if its source producers can be removed as well - transitively ineffectual instructions
-      int producers[3] = {instr_window[ort_regfile[r_out[1]].producer_idx].src_idx1,
-                          instr_window[ort_regfile[r_out[1]].producer_idx].src_idx2,
-                          instr_window[ort_regfile[r_out[1]].producer_idx].src_idx3};
-      _decrement_consumer(producers);
+      _decrement_consumer(w_links[ort_regfile[r_out[1]].producer_idx].src_idx);
 
     }
     //update regfile ORT
@@ -284,63 +513,121 @@ void _uref_check(const int * r_out)
 /*
 * check references in ORT memory table, and check if the current producer is unused
 */
-void _uref_check_mem(const int * r_in)
+void _uref_check_mem(const ir_event & ev)
 {
-  if (_mem_store_addr_0 != 0)
+  if (ev.store_addr[0] != 0)
   {
+    ort_page * pg = _ort_mem_page(ev.store_addr[0], true);
+    ort_entry & st = pg->entries[ORT_OFFSET(ev.store_addr[0])];
+
     //check if the previous producer was ever referenced
-    if ((ort_memory.find(_mem_store_addr_0) != ort_memory.end()) && ort_memory[_mem_store_addr_0].valid &&
-        !ort_memory[_mem_store_addr_0].referenced && ort_memory[_mem_store_addr_0].ort_pair == DNA ) {
+    if (st.valid && !st.referenced && st.ort_pair == DNA ) {
       sim_mem_uref_wr++;
+      if (!w_pc.empty())
+        _profile_add(w_pc[st.producer_idx], IR_UREF);
 
       //check if its source producers can be removed as well - transitively ineffectual instructions
-      int producers[3] = {instr_window[ort_memory[_mem_store_addr_0].producer_idx].src_idx1,
-                          instr_window[ort_memory[_mem_store_addr_0].producer_idx].src_idx2,
-                          instr_window[ort_memory[_mem_store_addr_0].producer_idx].src_idx3};
-      _decrement_consumer(producers);
+      _decrement_consumer(w_links[st.producer_idx].src_idx);
     }
 
     //update memory ORT
-    ort_memory[_mem_store_addr_0].valid = true;
-    ort_memory[_mem_store_addr_0].referenced = false;
-    ort_memory[_mem_store_addr_0].producer_idx = fifo_head;
-    ort_memory[_mem_store_addr_0].ort_pair = _mem_store_addr_1;
+    if (!st.valid)
+      pg->live += 1;
+    st.valid = true;
+    st.referenced = false;
+    st.producer_idx = fifo_head;
+    st.ort_pair = ev.store_addr[1];
   }
-  if (_mem_store_addr_1 != 0)
+  if (ev.store_addr[1] != 0)
   {
+    ort_page * pg = _ort_mem_page(ev.store_addr[1], true);
+    ort_entry & st = pg->entries[ORT_OFFSET(ev.store_addr[1])];
+
     //check if the previous producer was ever referenced
-    if ((ort_memory.find(_mem_store_addr_1) != ort_memory.end()) && ort_memory[_mem_store_addr_1].valid &&
-        !ort_memory[_mem_store_addr_1].referenced && ort_memory[_mem_store_addr_1].ort_pair == DNA ) {
+    if (st.valid && !st.referenced && st.ort_pair == DNA ) {
       sim_mem_uref_wr++;
+      if (!w_pc.empty())
+        _profile_add(w_pc[st.producer_idx], IR_UREF);
 
       //check if its source producers can be removed as well - transitively ineffectual instructions
-      int producers[3] = {instr_window[ort_memory[_mem_store_addr_1].producer_idx].src_idx1,
-                          instr_window[ort_memory[_mem_store_addr_1].producer_idx].src_idx2,
-                          instr_window[ort_memory[_mem_store_addr_1].producer_idx].src_idx3};
-      _decrement_consumer(producers);
+      _decrement_consumer(w_links[st.producer_idx].src_idx);
     }
 
     //update memory ORT
-    ort_memory[_mem_store_addr_1].valid = true;
-    ort_memory[_mem_store_addr_1].referenced = false;
-    ort_memory[_mem_store_addr_1].producer_idx = fifo_head;
-    ort_memory[_mem_store_addr_1].ort_pair = _mem_store_addr_0;
+    if (!st.valid)
+      pg->live += 1;
+    st.valid = true;
+    st.referenced = false;
+    st.producer_idx = fifo_head;
+    st.ort_pair = ev.store_addr[0];
   }
 }
 
-//return the PC of the most removed instruction
-extern "C" md_addr_t get_most_removed_instr()
+//the k pcs with the highest counts of a kind, highest first (ties: lower pc first); a
+//min-heap of size k holds the best candidates seen so far
+extern "C" int ir_detector_top(int kind, int k, md_addr_t * pcs, counter_t * counts)
 {
-  unsigned current_max = 0;
-  md_addr_t key_max  = 0;
-  for(auto it = removed_instr_map.cbegin(); it != removed_instr_map.cend(); ++it)
+  ir_detector_drain();
+
+  typedef std::pair<unsigned, md_addr_t> candidate;
+  //orders better candidates first, so the heap top is the worst one kept
+  auto better = [](const candidate & a, const candidate & b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  };
+  std::priority_queue<candidate, std::vector<candidate>, decltype(better)> heap(better);
+  for (size_t i = 0; i < pc_profile.size() && k > 0; i++)
   {
-     if(it->second > current_max) {
-        key_max = it->first;
-        current_max = it->second;
+     unsigned c = pc_profile[i].pc ? _profile_count(pc_profile[i], kind) : 0;
+     if (c == 0)
+        continue;
+     candidate cand(c, pc_profile[i].pc);
+     if ((int) heap.size() < k)
+        heap.push(cand);
+     else if (better(cand, heap.top())) {
+        heap.pop();
+        heap.push(cand);
      }
   }
-  return key_max;
+  int n = (int) heap.size();
+  for (int i = n - 1; i >= 0; i--) {
+     pcs[i] = heap.top().second;
+     counts[i] = heap.top().first;
+     heap.pop();
+  }
+  return n;
+}
+
+//print the k pcs with the most instances of each kind, bound to text symbols
+extern "C" void ir_detector_print_top(FILE * stream, int k)
+{
+  static const char * kind_names[IR_NUM_KINDS] =
+    { "nmod_reg", "nmod_mem", "uref", "branch", "transitive" };
+  std::vector<md_addr_t> pcs(k);
+  std::vector<counter_t> counts(k);
+
+  sym_loadsyms(ld_prog_fname, /* load_locals */TRUE);
+  for (int kind = 0; kind < IR_NUM_KINDS; kind++)
+  {
+    int n = ir_detector_top(kind, k, pcs.data(), counts.data());
+    fprintf(stream, "sim: ** top %d %s PCs **\n", n, kind_names[kind]);
+    for (int i = 0; i < n; i++)
+    {
+      struct sym_sym_t * sym = sym_bind_addr(pcs[i], NULL, /* !exact */FALSE, sdb_text);
+      fprintf(stream, "%3d 0x%08lx %12lld  ", i + 1, (unsigned long) pcs[i], (long long) counts[i]);
+      if (sym)
+        fprintf(stream, "%s+%d\n", sym->name, (int) (pcs[i] - sym->addr));
+      else
+        fprintf(stream, "<unknown>\n");
+    }
+  }
+}
+
+//return the PC of the most removed instruction
+extern "C" md_addr_t get_most_removed_instr()
+{
+  md_addr_t pc;
+  counter_t count;
+  return ir_detector_top(IR_NUM_KINDS, 1, &pc, &count) ? pc : 0;
 }
 
 /*
@@ -348,48 +635,46 @@ extern "C" md_addr_t get_most_removed_instr()
 * dynamic instructions in the window or the incoming instruction is ineffectual or not
 */
 
-extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, struct regs_t * p_regifle, const int * r_in, const int * r_out, md_addr_t pc, md_addr_t next_pc)
+void _process_event(const ir_event & ev)
 {
+   enum md_opcode op = ev.op;
+   md_addr_t pc = ev.pc;
+   md_addr_t next_pc = ev.next_pc;
+   const unsigned char * r_in = ev.r_in;
+   const unsigned char * r_out = ev.r_out;
+
    //if the new instruction is "removed" on entry, the IR detector should not update producer/consumer in ORT/Instr Window 
    bool rm_on_entry = false;
 
    //new FIFO entry to be enqueued to the instructrion window
-   fifo_entry incoming_instr;
-   incoming_instr.valid = true;
-   incoming_instr.src_idx1 = (r_in[0] != DNA) ? ort_regfile[r_in[0]].producer_idx : -1;
-   incoming_instr.src_idx2 = (r_in[1] != DNA) ? ort_regfile[r_in[1]].producer_idx : -1;
-   incoming_instr.src_idx3 = (r_in[2] != DNA) ? ort_regfile[r_in[2]].producer_idx : -1;
+   window_links incoming_links;
+   incoming_links.src_idx[0] = (r_in[0] != DNA) ? (int32_t) ort_regfile[r_in[0]].producer_idx : -1;
+   incoming_links.src_idx[1] = (r_in[1] != DNA) ? (int32_t) ort_regfile[r_in[1]].producer_idx : -1;
+   incoming_links.src_idx[2] = (r_in[2] != DNA) ? (int32_t) ort_regfile[r_in[2]].producer_idx : -1;
+   incoming_links.consumer_count = 0;
 
-   incoming_instr.reg_out1 = r_out[0];
-   incoming_instr.reg_out2 = r_out[1];
-   incoming_instr.mem_out1 = _mem_store_addr_0;
-   incoming_instr.mem_out2 = _mem_store_addr_1;
+   window_reg_out incoming_reg_out;
+   incoming_reg_out.reg_out1 = r_out[0];
+   incoming_reg_out.reg_out2 = r_out[1];
+
+   bool is_cond_br = false;
+   bool chk_ineff_br = false;
 
    //integer computation
    if (MD_OP_FLAGS(op) & F_ICOMP)
    {
-      if ((rm_on_entry =_nmod_check(false, regfile, p_regifle, r_out)))
+      if ((rm_on_entry =_nmod_check(false, ev)))
       {
-        if (removed_instr_map.find(pc) == removed_instr_map.end())
-        {
-           removed_instr_map[pc] = 1;
-        } else {
-           removed_instr_map[pc] += 1;
-        }
+        _profile_add(pc, IR_NMOD_REG);
         sim_reg_nmod_wr++;
       }
    }
    //float computation
    else if (MD_OP_FLAGS(op) & F_FCOMP)
    {
-      if ((rm_on_entry = _nmod_check(true, regfile, p_regifle, r_out)))
+      if ((rm_on_entry = _nmod_check(true, ev)))
       {
-        if (removed_instr_map.find(pc) == removed_instr_map.end())
-        {
-           removed_instr_map[pc] = 1;
-        } else {
-           removed_instr_map[pc] += 1;
-        }
+        _profile_add(pc, IR_NMOD_REG);
         sim_reg_nmod_wr++;
       }
    }
@@ -399,24 +684,14 @@ extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, st
    {
      //writing to a floating-point register [i.e. 32-63]
      if ( r_out[0] > 31 && r_out[0] < 64 ) {
-        if ((rm_on_entry = _nmod_check(true, regfile, p_regifle, r_out))) {
-          if (removed_instr_map.find(pc) == removed_instr_map.end())
-          {
-             removed_instr_map[pc] = 1;
-          } else {
-             removed_instr_map[pc] += 1;
-          }
+        if ((rm_on_entry = _nmod_check(true, ev))) {
+          _profile_add(pc, IR_NMOD_REG);
           sim_reg_nmod_wr++;
         }
      //writing to an integer register
      } else {
-        if ((rm_on_entry = _nmod_check(false, regfile, p_regifle, r_out))) {
-          if (removed_instr_map.find(pc) == removed_instr_map.end())
-          {
-             removed_instr_map[pc] = 1;
-          } else {
-             removed_instr_map[pc] += 1;
-          }
+        if ((rm_on_entry = _nmod_check(false, ev))) {
+          _profile_add(pc, IR_NMOD_REG);
           sim_reg_nmod_wr++;
         }
      }
@@ -424,25 +699,15 @@ extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, st
    //producer memory ort, consumer for reg ort
    else if (MD_OP_FLAGS(op) & F_STORE)
    {
-      if ((rm_on_entry = _nmod_check_mem())) {
-        if (removed_instr_map.find(pc) == removed_instr_map.end())
-        {
-           removed_instr_map[pc] = 1;
-        } else {
-           removed_instr_map[pc] += 1;
-        }
+      if ((rm_on_entry = _nmod_check_mem(ev))) {
+        _profile_add(pc, IR_NMOD_MEM);
         sim_mem_nmod_wr++;
       }
    }
    //unconditional branches are marked as ineffectual upon entry
    else if (MD_OP_FLAGS(op) & F_CALL || MD_OP_FLAGS(op) & F_UNCOND)
    {
-      if (removed_instr_map.find(pc) == removed_instr_map.end())
-      {
-         removed_instr_map[pc] = 1;
-      } else {
-         removed_instr_map[pc] += 1;
-      }
+      _profile_add(pc, IR_BRANCH);
       rm_on_entry = true;
       sim_inef_br++;
    }
@@ -450,7 +715,7 @@ extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, st
    //if they are ineffectual in the context of instruction window
    else if (MD_OP_FLAGS(op) & F_COND)
    {
-      incoming_instr.branch_pc = pc;
+      is_cond_br = true;
 
       if (btb_map.find(pc) == btb_map.end() || btb_map[pc].valid_cnt == 0)
       {
@@ -465,7 +730,7 @@ extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, st
         else if (btb_map[pc].const_tgt)
         {
           //this branch may be ineffectual; keep track of it
-          incoming_instr.chk_ineff_br = true;
+          chk_ineff_br = true;
         }
 
         //increment number of dynamic instances of this branch in the instruction window
@@ -477,9 +742,9 @@ extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, st
    //update references and check for unreferenced writes in ORT table
    if (!rm_on_entry)
    {
-      _ref_update(r_in);
+      _ref_update(ev);
       if (MD_OP_FLAGS(op) & F_STORE)
-        _uref_check_mem(r_in);
+        _uref_check_mem(ev);
       else
         _uref_check(r_out);
    }
@@ -489,70 +754,167 @@ extern "C" void process_new_instr(enum md_opcode op, struct regs_t * regfile, st
    //we consider that the branch instruction is likely to be an ineffectual instruction, and we trigger
    //decrement_consumer routine on its producers which may make them transitively ineffectual
    //not 100% accurate, but it is a reasonable compromise
-   if (instr_window[fifo_mid].chk_ineff_br) {
-      if (btb_map[instr_window[fifo_mid].branch_pc].const_tgt)
-      {
-        //check if its source producers can be removed as well - transitively ineffectual instructions
-        int producers[3] = {instr_window[fifo_mid].src_idx1,
-                            instr_window[fifo_mid].src_idx2,
-                            instr_window[fifo_mid].src_idx3};
-        _decrement_consumer(producers);
-
+   //the slot at fifo_mid holds the instruction mid_delay instructions back, at fifo_head the one w_size back
+   size_t w_size = w_links.size();
+   size_t mid_delay = w_size - w_size / 2;
+   if (w_seq >= mid_delay) {
+      while (br_mid < br_queue.size() && br_queue[br_mid].seq < w_seq - mid_delay)
+        br_mid++;
+      if (br_mid < br_queue.size() && br_queue[br_mid].seq == w_seq - mid_delay && br_queue[br_mid].chk_ineff_br) {
+        if (btb_map[br_queue[br_mid].branch_pc].const_tgt)
+        {
+          //check if its source producers can be removed as well - transitively ineffectual instructions
+          _decrement_consumer(w_links[fifo_mid].src_idx);
+        }
       }
    }
    //at the end of instruction window, check if BTB indicates a target address has changed; if not
    //the branch instruction is definitely an ineffectual branch
-   if (instr_window[fifo_head].branch_pc != 0) {
-      if (btb_map[instr_window[fifo_head].branch_pc].const_tgt)
+   if (!br_queue.empty() && w_seq >= w_size && br_queue.front().seq == w_seq - w_size) {
+      md_addr_t branch_pc = br_queue.front().branch_pc;
+      if (btb_map[branch_pc].const_tgt)
       {
         sim_inef_br++;
-        if (removed_instr_map.find(instr_window[fifo_head].branch_pc) == removed_instr_map.end())
-        {
-           removed_instr_map[instr_window[fifo_head].branch_pc] = 1;
-        } else {
-           removed_instr_map[instr_window[fifo_head].branch_pc] += 1;
-        }
+        _profile_add(branch_pc, IR_BRANCH);
       }
-      if (btb_map[instr_window[fifo_head].branch_pc].valid_cnt > 0)
-          btb_map[instr_window[fifo_head].branch_pc].valid_cnt -= 1;
+      if (btb_map[branch_pc].valid_cnt > 0)
+          btb_map[branch_pc].valid_cnt -= 1;
+      br_queue.pop_front();
+      if (br_mid > 0)
+        br_mid--;
    }
 
    //Instruction Window size check; if the window is not yet full, no instruction gets evicted
-   if (w_instr_cnt < instr_window.size()) {
+   if (w_instr_cnt < w_size) {
      w_instr_cnt += 1;
 
    //Instruction is being evicted out from the window
    } else {
      //1) Invalidate ORT entry of the oldest instruction being evicted out from the window
-     if(ort_regfile[instr_window[fifo_head].reg_out1].valid &&
-        ort_regfile[instr_window[fifo_head].reg_out1].producer_idx == fifo_head)
+     window_reg_out & out = w_reg_out[fifo_head];
+     if(ort_regfile[out.reg_out1].valid &&
+        ort_regfile[out.reg_out1].producer_idx == fifo_head)
      {
-        ort_regfile[instr_window[fifo_head].reg_out1].valid = false;
+        ort_regfile[out.reg_out1].valid = false;
      }
-     if(ort_regfile[instr_window[fifo_head].reg_out2].valid &&
-        ort_regfile[instr_window[fifo_head].reg_out2].producer_idx == fifo_head)
+     if(ort_regfile[out.reg_out2].valid &&
+        ort_regfile[out.reg_out2].producer_idx == fifo_head)
      {
-        ort_regfile[instr_window[fifo_head].reg_out2].valid = false;
+        ort_regfile[out.reg_out2].valid = false;
      }
-     if((ort_memory.find(instr_window[fifo_head].mem_out1) != ort_memory.end()) && ort_memory[instr_window[fifo_head].mem_out1].valid
-      && ort_memory[instr_window[fifo_head].mem_out1].producer_idx == fifo_head)
-     {
-        ort_memory[instr_window[fifo_head].mem_out1].valid = false;
-     }
-     if((ort_memory.find(instr_window[fifo_head].mem_out2) != ort_memory.end()) && ort_memory[instr_window[fifo_head].mem_out2].valid
-      && ort_memory[instr_window[fifo_head].mem_out2].producer_idx == fifo_head)
-     {
-        ort_memory[instr_window[fifo_head].mem_out2].valid = false;
+     _ort_mem_release(w_mem_out[fifo_head], fifo_head);
+     if (!mem2_queue.empty() && mem2_queue.front().seq == w_seq - w_size) {
+        _ort_mem_release(mem2_queue.front().mem_out2, fifo_head);
+        mem2_queue.pop_front();
      }
      //End of 1)
 
      //2) If its consumer count is 0, it is deemed ineffectual ("no valid instruction consumes its value")
-     if (instr_window[fifo_head].consumer_count == 0)
+     if (w_links[fifo_head].consumer_count == 0) {
        sim_transitive_ineff++; 
+       if (!w_pc.empty())
+         _profile_add(w_pc[fifo_head], IR_TRANSITIVE);
+     }
    }
 
    //Instruction window update; increment FIFO indices
-   instr_window[fifo_head] = incoming_instr;
+   w_links[fifo_head] = incoming_links;
+   w_reg_out[fifo_head] = incoming_reg_out;
+   if (!w_pc.empty())
+     w_pc[fifo_head] = pc;
+   w_mem_out[fifo_head] = ev.store_addr[0];
+   if (is_cond_br) {
+      window_branch br = { w_seq, pc, chk_ineff_br };
+      br_queue.push_back(br);
+   }
+   if (ev.store_addr[1] != 0) {
+      window_mem_out2 m = { w_seq, ev.store_addr[1] };
+      mem2_queue.push_back(m);
+   }
+   w_seq++;
    p_incr_fifo_ptr(fifo_head);
    p_incr_fifo_ptr(fifo_mid);
 }
+
+/* DECOUPLED DETECTOR */
+
+//single-producer/single-consumer ring of retirement records: the simulator publishes a
+//record by advancing ring_tail, the detector thread frees it by advancing ring_head.
+//Both indices run freely; the slot of index i is ring[i & ring_mask]. The thread
+//processes the records in retirement order, so the counters match the inline mode.
+std::vector<ir_event> ring;
+size_t ring_mask;
+alignas(64) std::atomic<size_t> ring_head(0);
+alignas(64) std::atomic<size_t> ring_tail(0);
+alignas(64) size_t ring_head_seen = 0;   //producer's last view of ring_head
+std::atomic<bool> ring_stop(false);
+std::thread ring_thread;
+bool ring_active = false;
+
+void _ring_consume()
+{
+  size_t head = ring_head.load(std::memory_order_relaxed);
+  while (true)
+  {
+    size_t tail = ring_tail.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+      //ring_stop is raised after the last record is published
+      if (ring_stop.load(std::memory_order_acquire) && head == ring_tail.load(std::memory_order_acquire))
+        return;
+      std::this_thread::yield();
+      continue;
+    }
+    for (; head != tail; head++)
+    {
+      _process_event(ring[head & ring_mask]);
+      ring_head.store(head + 1, std::memory_order_release);
+    }
+  }
+}
+
+void _ring_start(size_t ring_size)
+{
+  size_t n = 1;
+  while (n < ring_size)
+    n <<= 1;
+  ring.assign(n, ir_event());
+  ring_mask = n - 1;
+  ring_head.store(0);
+  ring_tail.store(0);
+  ring_head_seen = 0;
+  ring_stop.store(false);
+  try {
+    ring_thread = std::thread(_ring_consume);
+    ring_active = true;
+  } catch (const std::system_error & e) {
+    std::cerr << "ir_detector: cannot start the detector thread (" << e.what() << "), running inline" << std::endl;
+  }
+}
+
+extern "C" void process_new_instr(const struct ir_event * ev)
+{
+  if (!ring_active)
+  {
+    _process_event(*ev);
+    return;
+  }
+  size_t tail = ring_tail.load(std::memory_order_relaxed);
+  while (tail - ring_head_seen == ring.size())
+  {
+    ring_head_seen = ring_head.load(std::memory_order_acquire);
+    if (tail - ring_head_seen == ring.size())
+      std::this_thread::yield();
+  }
+  ring[tail & ring_mask] = *ev;
+  ring_tail.store(tail + 1, std::memory_order_release);
+}
+
+extern "C" void ir_detector_drain()
+{
+  if (!ring_active)
+    return;
+  ring_stop.store(true, std::memory_order_release);
+  ring_thread.join();
+  ring_active = false;
+}
@@ -16,9 +16,63 @@ enum branch_t
   TAKEN=0, NOT_TAKEN=1, MIXED=2
 };
 
+/* kinds of ineffectual instances counted per PC (ir_detector_top) */
+enum ir_kind_t
+{
+  IR_NMOD_REG=0, IR_NMOD_MEM=1, IR_UREF=2, IR_BRANCH=3, IR_TRANSITIVE=4, IR_NUM_KINDS=5
+};
+
+
+/* value of an output register before the instruction executes: the two words of regs_t,
+   viewed as an array of words, at the register's dependence number (DGPR/DFPR/DHI...);
+   a double-precision FP register spans both */
+struct ir_reg_value
+{
+  sword_t w[2];
+};
+
+/* save output register N of *REGS into V; done by the DEFINST expansion before and
+   after the instruction executes, instead of copying the whole register file */
+#define IR_SAVE_REG(REGS, N, V)						\
+  ((V).w[0] = ((sword_t *)(REGS))[N], (V).w[1] = ((sword_t *)(REGS))[(N) + 1])
 
-void ir_detector_setup(size_t w_size);
+/* retirement record of one instruction: everything the IR detector reads */
+struct ir_event
+{
+  enum md_opcode op;
+  md_addr_t pc;
+  md_addr_t next_pc;
+  unsigned char r_in[3];                /* dependence numbers, DNA if unused */
+  unsigned char r_out[2];
+  struct ir_reg_value out_pre[2];       /* r_out values before and after execution */
+  struct ir_reg_value out_post[2];
+  md_addr_t load_addr[2];               /* word addresses, 0 if unused */
+  md_addr_t store_addr[2];
+  word_t store_old[2];                  /* stored words before and after the store */
+  word_t store_new[2];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* w_size: instruction window; ring_size: records buffered for a detector thread,
+   0 runs the detector inline in process_new_instr; profile_slots: keep the PC of
+   every window slot, so IR_UREF and IR_TRANSITIVE are counted per PC too */
+void ir_detector_setup(size_t w_size, size_t ring_size, int profile_slots);
 md_addr_t get_most_removed_instr();
-void process_new_instr(enum md_opcode op, struct regs_t * regfile, struct regs_t * p_regifle, const int * r_in, const int * r_out, md_addr_t pc, md_addr_t next_pc);
+/* the (at most) K PCs with the most ineffectual instances of KIND, most first, into
+   PCS and COUNTS; KIND IR_NUM_KINDS counts the instances removed on entry or as
+   branches (get_most_removed_instr); returns the number found */
+int ir_detector_top(int kind, int k, md_addr_t * pcs, counter_t * counts);
+/* print the top K PCs of every kind, bound to text symbols */
+void ir_detector_print_top(FILE * stream, int k);
+void process_new_instr(const struct ir_event * ev);
+/* wait until the detector thread has processed every record (no-op inline) */
+void ir_detector_drain();
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
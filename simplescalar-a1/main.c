@@ -216,6 +216,9 @@ sim_print_stats(FILE *fd)		/* output stream */
 static void
 exit_now(int exit_code)
 {
+  /* let the IR detector finish before its counters are printed */
+  ir_detector_drain();
+
   /* print simulation stats */
   sim_print_stats(stderr);
   myfprintf(stderr, "PARKLAWR: PC of most removed instr: 0x%08x\n", get_most_removed_instr());
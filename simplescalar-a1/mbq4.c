@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+#define FIXED_WORD 0xCAFEBABE
+
+/*
+* Microbenchmark 4 : long transitive chains
+*                    acc is built by a chain of dependent adds that is never read; overwriting
+*                    it makes the whole chain (and each iteration's t) transitively ineffectual
+*                    in one _decrement_consumer call. Run with -window:size above 4 * size, and
+*                    read sim_inst_rate (throughput) and sim_ineff_worklist_peak (peak worklist
+*                    depth) from the statistics
+*/
+int main(int argc, char *argv[])
+{
+  int i;
+  int size = atoi(argv[1]);
+
+  register int acc = 0;
+  register int t;
+
+  for(i=0; i<size; i=i+1)
+  {
+     t = i ^ 0x11111111;
+     acc = acc + t;
+  }
+
+  acc = FIXED_WORD;
+}
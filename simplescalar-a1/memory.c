@@ -74,6 +74,8 @@ mem_create(char *name)			/* name of the memory space */
   return mem;
 }
 
+#ifdef MEM_HASHED_PTAB
+
 /* translate address ADDR in memory space MEM, returns pointer to host page */
 byte_t *
 mem_translate(struct mem_t *mem,	/* memory space to access */
@@ -134,6 +136,72 @@ mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
   mem->page_count++;
 }
 
+#else /* !MEM_HASHED_PTAB */
+
+/* translate address ADDR in memory space MEM, returns pointer to host page */
+byte_t *
+mem_translate(struct mem_t *mem,	/* memory space to access */
+	      md_addr_t addr)		/* virtual address to translate */
+{
+  /* radix table lookups never miss, MEM_PAGE() does all the work */
+  return MEM_PAGE(mem, addr);
+}
+
+/* allocate a zeroed radix page table level of NENTRIES pointers */
+static void *
+mem_newtable(int nentries)		/* number of entries in the level */
+{
+  void *tab;
+
+  tab = calloc(nentries, sizeof(void *));
+  if (!tab)
+    fatal("out of virtual memory");
+  return tab;
+}
+
+/* allocate a memory page */
+void
+mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
+	    md_addr_t addr)		/* virtual address to allocate */
+{
+  byte_t *page, **leaf;
+  struct mem_pte_t *pte;
+
+  /* see misc.c for details on the getcore() function */
+  page = getcore(MD_PAGE_SIZE);
+  if (!page)
+    fatal("out of virtual memory");
+
+  /* walk the radix table, allocating missing levels */
+#ifdef MD_QWORD_ADDRS
+  if (!mem->ptab[MEM_ROOT_IDX(addr)])
+    mem->ptab[MEM_ROOT_IDX(addr)] = mem_newtable(1 << MEM_LOG_MID_SIZE);
+  leaf = mem->ptab[MEM_ROOT_IDX(addr)][MEM_MID_IDX(addr)];
+  if (!leaf)
+    leaf = mem->ptab[MEM_ROOT_IDX(addr)][MEM_MID_IDX(addr)] =
+      mem_newtable(MEM_LEAF_SIZE);
+#else /* !MD_QWORD_ADDRS */
+  leaf = mem->ptab[MEM_ROOT_IDX(addr)];
+  if (!leaf)
+    leaf = mem->ptab[MEM_ROOT_IDX(addr)] = mem_newtable(MEM_LEAF_SIZE);
+#endif /* MD_QWORD_ADDRS */
+  leaf[MEM_LEAF_IDX(addr)] = page;
+
+  /* record the page for MEM_FORALL() */
+  pte = calloc(1, sizeof(struct mem_pte_t));
+  if (!pte)
+    fatal("out of virtual memory");
+  pte->tag = addr >> MD_LOG_PAGE_SIZE;
+  pte->page = page;
+  pte->next = mem->pages;
+  mem->pages = pte;
+
+  /* one more page allocated */
+  mem->page_count++;
+}
+
+#endif /* MEM_HASHED_PTAB */
+
 /* generic memory access function, it's safe because alignments and permissions
    are checked, handles any natural transfer sizes; note, faults out if nbytes
    is not a power-of-two or larger then MD_PAGE_SIZE */
@@ -234,6 +302,7 @@ mem_reg_stats(struct mem_t *mem,	/* memory space to declare */
   stat_reg_formula(sdb, buf, "total size of memory pages allocated",
 		   buf1, "%11.0fk");
 
+#ifdef MEM_HASHED_PTAB
   sprintf(buf, "%s.ptab_misses", mem->name);
   stat_reg_counter(sdb, buf, "total first level page table misses",
 		   &mem->ptab_misses, mem->ptab_misses, NULL);
@@ -245,6 +314,7 @@ mem_reg_stats(struct mem_t *mem,	/* memory space to declare */
   sprintf(buf, "%s.ptab_miss_rate", mem->name);
   sprintf(buf1, "%s.ptab_misses / %s.ptab_accesses", mem->name, mem->name);
   stat_reg_formula(sdb, buf, "first level page table miss rate", buf1, NULL);
+#endif /* MEM_HASHED_PTAB */
 }
 
 /* initialize memory system, call before loader.c */
@@ -253,13 +323,21 @@ mem_init(struct mem_t *mem)	/* memory space to initialize */
 {
   int i;
 
+#ifdef MEM_HASHED_PTAB
   /* initialize the first level page table to all empty */
   for (i=0; i < MEM_PTAB_SIZE; i++)
     mem->ptab[i] = NULL;
 
-  mem->page_count = 0;
   mem->ptab_misses = 0;
   mem->ptab_accesses = 0;
+#else /* !MEM_HASHED_PTAB */
+  /* initialize the radix table root to all empty */
+  for (i=0; i < MEM_ROOT_SIZE; i++)
+    mem->ptab[i] = NULL;
+  mem->pages = NULL;
+#endif /* MEM_HASHED_PTAB */
+
+  mem->page_count = 0;
 }
 
 /* dump a block of memory, returns any faults encountered */
@@ -60,6 +60,15 @@
 #include "options.h"
 #include "stats.h"
 
+/* page table organization: by default a radix table indexed directly by the
+   virtual page number, two levels for 32-bit target addresses and three for
+   64-bit ones, so a translation is a couple of dependent loads with no hash
+   or tag compare; define MEM_HASHED_PTAB to use the inverted (hashed) page
+   table instead */
+/* #define MEM_HASHED_PTAB */
+
+#ifdef MEM_HASHED_PTAB
+
 /* number of entries in page translation hash table (must be power-of-two) */
 #define MEM_PTAB_SIZE		(32*1024)
 #define MEM_LOG_PTAB_SIZE	15
@@ -83,6 +92,47 @@ struct mem_t {
   counter_t ptab_accesses;		/* total page table accesses */
 };
 
+#else /* !MEM_HASHED_PTAB */
+
+/* radix page table geometry, log2 of the entries per table level */
+#ifdef MD_QWORD_ADDRS
+/* 64-bit addresses, 8k pages: 51-bit virtual page numbers */
+#define MEM_LOG_LEAF_SIZE	17
+#define MEM_LOG_MID_SIZE	17
+#define MEM_LOG_ROOT_SIZE	17
+#else /* !MD_QWORD_ADDRS */
+/* 32-bit addresses, 4k pages: 20-bit virtual page numbers */
+#define MEM_LOG_LEAF_SIZE	10
+#define MEM_LOG_ROOT_SIZE	10
+#endif /* MD_QWORD_ADDRS */
+
+#define MEM_LEAF_SIZE		(1 << MEM_LOG_LEAF_SIZE)
+#define MEM_ROOT_SIZE		(1 << MEM_LOG_ROOT_SIZE)
+
+/* page table entry, only used to enumerate the allocated pages */
+struct mem_pte_t {
+  struct mem_pte_t *next;	/* next allocated page */
+  md_addr_t tag;		/* virtual page number */
+  byte_t *page;			/* page pointer */
+};
+
+/* memory object */
+struct mem_t {
+  /* memory object state */
+  char *name;				/* name of this memory space */
+#ifdef MD_QWORD_ADDRS
+  byte_t ***ptab[MEM_ROOT_SIZE];	/* radix page table root */
+#else /* !MD_QWORD_ADDRS */
+  byte_t **ptab[MEM_ROOT_SIZE];		/* radix page table root */
+#endif /* MD_QWORD_ADDRS */
+  struct mem_pte_t *pages;		/* all allocated pages */
+
+  /* memory object stats */
+  counter_t page_count;			/* total number of pages allocated */
+};
+
+#endif /* MEM_HASHED_PTAB */
+
 /* memory access command */
 enum mem_cmd {
   Read,			/* read memory from target (simulated prog) to host */
@@ -102,6 +152,8 @@ typedef enum md_fault_type
  * virtual to host page translation macros
  */
 
+#ifdef MEM_HASHED_PTAB
+
 /* compute page table set */
 #define MEM_PTAB_SET(ADDR)						\
   (((ADDR) >> MD_LOG_PAGE_SIZE) & (MEM_PTAB_SIZE - 1))
@@ -126,6 +178,52 @@ typedef enum md_fault_type
    : (/* first level miss - call the translation helper function */	\
       mem_translate((MEM), (ADDR))))
 
+/* memory page iterator */
+#define MEM_FORALL(MEM, ITER, PTE)					\
+  for ((ITER)=0; (ITER) < MEM_PTAB_SIZE; (ITER)++)			\
+    for ((PTE)=(MEM)->ptab[i]; (PTE) != NULL; (PTE)=(PTE)->next)
+
+#else /* !MEM_HASHED_PTAB */
+
+/* compute the radix page table indices of address ADDR */
+#define MEM_LEAF_IDX(ADDR)						\
+  (((ADDR) >> MD_LOG_PAGE_SIZE) & (MEM_LEAF_SIZE - 1))
+#ifdef MD_QWORD_ADDRS
+#define MEM_MID_IDX(ADDR)						\
+  (((ADDR) >> (MD_LOG_PAGE_SIZE + MEM_LOG_LEAF_SIZE))			\
+   & ((1 << MEM_LOG_MID_SIZE) - 1))
+#define MEM_ROOT_IDX(ADDR)						\
+  (((ADDR) >> (MD_LOG_PAGE_SIZE + MEM_LOG_LEAF_SIZE + MEM_LOG_MID_SIZE))\
+   & (MEM_ROOT_SIZE - 1))
+#else /* !MD_QWORD_ADDRS */
+#define MEM_ROOT_IDX(ADDR)						\
+  (((ADDR) >> (MD_LOG_PAGE_SIZE + MEM_LOG_LEAF_SIZE)) & (MEM_ROOT_SIZE - 1))
+#endif /* MD_QWORD_ADDRS */
+
+/* convert a pte entry to a block address, IDX is unused */
+#define MEM_PTE_ADDR(PTE, IDX)						\
+  ((PTE)->tag << MD_LOG_PAGE_SIZE)
+
+/* locate host page for virtual address ADDR, returns NULL if unallocated */
+#ifdef MD_QWORD_ADDRS
+#define MEM_PAGE(MEM, ADDR)						\
+  (((MEM)->ptab[MEM_ROOT_IDX(ADDR)]					\
+    && (MEM)->ptab[MEM_ROOT_IDX(ADDR)][MEM_MID_IDX(ADDR)])		\
+   ? (MEM)->ptab[MEM_ROOT_IDX(ADDR)][MEM_MID_IDX(ADDR)][MEM_LEAF_IDX(ADDR)]\
+   : NULL)
+#else /* !MD_QWORD_ADDRS */
+#define MEM_PAGE(MEM, ADDR)						\
+  ((MEM)->ptab[MEM_ROOT_IDX(ADDR)]					\
+   ? (MEM)->ptab[MEM_ROOT_IDX(ADDR)][MEM_LEAF_IDX(ADDR)]		\
+   : NULL)
+#endif /* MD_QWORD_ADDRS */
+
+/* memory page iterator */
+#define MEM_FORALL(MEM, ITER, PTE)					\
+  for ((ITER)=0, (PTE)=(MEM)->pages; (PTE) != NULL; (PTE)=(PTE)->next)
+
+#endif /* MEM_HASHED_PTAB */
+
 /* compute address of access within a host page */
 #define MEM_OFFSET(ADDR)	((ADDR) & (MD_PAGE_SIZE - 1))
 
@@ -136,11 +234,6 @@ typedef enum md_fault_type
       mem_newpage(MEM, ADDR))						\
    : (/* nada... */ (void)0))
 
-/* memory page iterator */
-#define MEM_FORALL(MEM, ITER, PTE)					\
-  for ((ITER)=0; (ITER) < MEM_PTAB_SIZE; (ITER)++)			\
-    for ((PTE)=(MEM)->ptab[i]; (PTE) != NULL; (PTE)=(PTE)->next)
-
 
 /*
  * memory accessors macros, fast but difficult to debug...
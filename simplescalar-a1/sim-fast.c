@@ -64,6 +64,9 @@
  * The following options configure the bag of tricks used to make sim-fast
  * live up to its name.  For most machines, defining all the options results
  * in the fastest functional simulator.
+ *
+ * Compiled with -DIR_DETECT (sim-fast-ir), every executed instruction is also
+ * handed to the IR detector, with the same counters and options as sim-safe.
  */
 
 /* don't count instructions flag, enabled by default, disable for inst count */
@@ -74,6 +77,12 @@
    versions of GNU GCC core dump when optimizing the jump table code with
    optimization levels higher than -O1 */
 /* #define USE_JUMP_TABLE */
+
+/* direct-threaded basic-block translation cache, also GNU GCC specific and
+   used instead of the jump table when both are defined: each basic block is
+   decoded once into an array of (handler, instruction) pairs, and every
+   handler jumps straight to the next one, without fetch or decode */
+#define USE_BB_CACHE
 #endif /* __GNUC__ */
 
 #include "host.h"
@@ -85,6 +94,8 @@
 #include "syscall.h"
 #include "dlite.h"
 #include "sim.h"
+#include "ir_detector.h"
+#include "ir_counters.h"
 
 /* simulated registers */
 static struct regs_t regs;
@@ -97,6 +108,68 @@ static struct mem_t *mem = NULL;
 static struct mem_t *dec = NULL;
 #endif
 
+/* memory accesses of the current instruction, recorded by machine.def */
+md_addr_t _mem_load_addr_0;
+md_addr_t _mem_load_addr_1;
+
+md_addr_t _mem_store_addr_0;
+md_addr_t _mem_store_addr_1;
+
+word_t _mem_store_new_word_0;
+word_t _mem_store_new_word_1;
+word_t _mem_store_old_word_0;
+word_t _mem_store_old_word_1;
+
+#ifdef IR_DETECT
+/* instruction window size */
+static unsigned int window_size;
+
+/* IR-detector ring size (records); 0 runs the detector inline */
+static unsigned int ir_ring_size;
+
+/* PCs listed per kind of ineffectual instance; 0 disables the report */
+static unsigned int ir_top;
+
+/* retirement record of the current instruction for the IR detector */
+static struct ir_event ir_ev;
+#endif /* IR_DETECT */
+
+#ifdef USE_BB_CACHE
+/* maximum instructions in a translated basic block */
+#define BB_MAX_INSNS		64
+
+/* block cache hash table size, a power of two */
+#define BB_HASH_SIZE		16384
+#define BB_HASH(PC)		(((PC) / sizeof(md_inst_t)) & (BB_HASH_SIZE - 1))
+
+/* translated instruction: its handler in sim_main(), and the instruction
+   itself, which the handler's operand field macros decode */
+struct bb_insn {
+  void *handler;
+  md_inst_t inst;
+};
+
+/* translated basic block: straight-line code up to and including the first
+   control transfer or trap */
+struct bb_block {
+  struct bb_block *next;		/* next block in hash bucket */
+  md_addr_t pc;				/* address of the first instruction */
+  int ninsn;				/* number of instructions */
+  struct bb_insn insn[1];		/* NINSN translated instructions */
+};
+
+/* block cache, indexed by BB_HASH() of the block address */
+static struct bb_block *bb_table[BB_HASH_SIZE];
+
+/* non-zero after a write to the text segment, the cache is flushed before
+   the next block is looked up */
+static int bb_stale = FALSE;
+
+/* block cache statistics */
+static counter_t bb_translations = 0;
+static counter_t bb_flushes = 0;
+#endif /* USE_BB_CACHE */
+
 /* register simulator-specific options */
 void
 sim_reg_options(struct opt_odb_t *odb)
@@ -110,6 +183,22 @@ sim_reg_options(struct opt_odb_t *odb)
 "causing sim-fast to execute incorrectly or dump core.  Such is the\n"
 "price we pay for speed!!!!\n"
 		 );
+
+#ifdef IR_DETECT
+  opt_reg_uint(odb, "-window:size", "instruction window size",
+	       &window_size, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_uint(odb, "-ir:ring", "records buffered for a separate IR-detector "
+	       "thread (0: run the detector inline)",
+	       &ir_ring_size, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_uint(odb, "-ir:top", "report the PCs with the most ineffectual "
+	       "instances of each kind (0: no report)",
+	       &ir_top, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+#endif /* IR_DETECT */
 }
 
 /* check simulator-specific option values */
@@ -137,6 +226,37 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 		   "simulation speed (in insts/sec)",
 		   "sim_num_insn / sim_elapsed_time", NULL);
 #endif /* !NO_INSN_COUNT */
+#ifdef IR_DETECT
+  stat_reg_counter(sdb, "sim_reg_nmod_wr",
+		   "total non-modifying register writes",
+		   &sim_reg_nmod_wr, 0, NULL);
+  stat_reg_counter(sdb, "sim_reg_uref_wr",
+		   "total unreferenced register writes",
+		   &sim_reg_uref_wr, 0, NULL);
+  stat_reg_counter(sdb, "sim_inef_br",
+		   "total ineffectual branches",
+		   &sim_inef_br, 0, NULL);
+  stat_reg_counter(sdb, "sim_transitive_ineff",
+		   "total transitively ineffectual instructions",
+		   &sim_transitive_ineff, 0, NULL);
+  stat_reg_counter(sdb, "sim_mem_nmod_wr",
+		   "total non-modifying memory writes",
+		   &sim_mem_nmod_wr, 0, NULL);
+  stat_reg_counter(sdb, "sim_mem_uref_wr",
+		   "total unreferenced memory writes",
+		   &sim_mem_uref_wr, 0, NULL);
+  stat_reg_counter(sdb, "sim_ineff_worklist_peak",
+		   "peak producer worklist depth of transitive checks",
+		   &sim_ineff_worklist_peak, 0, NULL);
+#endif /* IR_DETECT */
+#ifdef USE_BB_CACHE
+  stat_reg_counter(sdb, "sim_bb_translations",
+		   "basic blocks translated into the block cache",
+		   &bb_translations, 0, NULL);
+  stat_reg_counter(sdb, "sim_bb_flushes",
+		   "block cache flushes after writes to the text segment",
+		   &bb_flushes, 0, NULL);
+#endif /* USE_BB_CACHE */
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
 #ifdef TARGET_ALPHA
@@ -210,7 +330,10 @@ sim_aux_config(FILE *stream)
 void
 sim_aux_stats(FILE *stream)
 {
-  /* nada */
+#ifdef IR_DETECT
+  if (ir_top)
+    ir_detector_print_top(stream, ir_top);
+#endif /* IR_DETECT */
 }
 
 /* un-initialize simulator-specific state */
@@ -236,6 +359,21 @@ sim_uninit(void)
 
 #if defined(TARGET_PISA)
 
+/* general register dependence decoders */
+#define DGPR(N)			(N)
+#define DGPR_D(N)		((N) &~1)
+
+/* floating point register dependence decoders */
+#define DFPR_L(N)		(((N)+32)&~1)
+#define DFPR_F(N)		(((N)+32)&~1)
+#define DFPR_D(N)		(((N)+32)&~1)
+
+/* miscellaneous register dependence decoders */
+#define DHI			(0+32+32)
+#define DLO			(1+32+32)
+#define DFCC			(2+32+32)
+#define DTMP			(3+32+32)
+
 /* floating point registers, L->word, F->single-prec, D->double-prec */
 #define FPR_L(N)		(regs.regs_F.l[(N)])
 #define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
@@ -270,6 +408,16 @@ sim_uninit(void)
 #error No ISA target defined...
 #endif
 
+#ifdef USE_BB_CACHE
+/* a store to the text segment leaves the block cache stale: end the current
+   block after this instruction, the cache is flushed before the next one */
+#define BB_TEXT_WRITE(ADDR)						\
+  ((md_addr_t)(ADDR) - ld_text_base < ld_text_size			\
+   ? (bb_stale = TRUE, bb_end = bb_ip + 1, 0) : 0)
+#else /* !USE_BB_CACHE */
+#define BB_TEXT_WRITE(ADDR)	0
+#endif /* USE_BB_CACHE */
+
 /* precise architected memory state accessor macros */
 #define READ_BYTE(SRC, FAULT)						\
   ((FAULT) = md_fault_none, MEM_READ_BYTE(mem, (SRC)))
@@ -283,18 +431,42 @@ sim_uninit(void)
 #endif /* HOST_HAS_QWORD */
 
 #define WRITE_BYTE(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_BYTE(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, BB_TEXT_WRITE(DST),			\
+   MEM_WRITE_BYTE(mem, (DST), (SRC)))
 #define WRITE_HALF(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_HALF(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, BB_TEXT_WRITE(DST),			\
+   MEM_WRITE_HALF(mem, (DST), (SRC)))
 #define WRITE_WORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_WORD(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, BB_TEXT_WRITE(DST),			\
+   MEM_WRITE_WORD(mem, (DST), (SRC)))
 #ifdef HOST_HAS_QWORD
 #define WRITE_QWORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_QWORD(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, BB_TEXT_WRITE(DST),			\
+   MEM_WRITE_QWORD(mem, (DST), (SRC)))
 #endif /* HOST_HAS_QWORD */
 
+#ifdef USE_BB_CACHE
+/* memory accessor for system calls, which may write the text segment too;
+   system calls end their block, so the flush happens before the next one */
+static enum md_fault_type
+bb_mem_access(struct mem_t *mem,	/* memory space to access */
+	      enum mem_cmd cmd,		/* Read (from sim mem) or Write */
+	      md_addr_t addr,		/* target address to access */
+	      void *vp,			/* host memory address to access */
+	      int nbytes)		/* number of bytes to access */
+{
+  if (cmd == Write
+      && addr < ld_text_base + ld_text_size && addr + nbytes > ld_text_base)
+    bb_stale = TRUE;
+  return mem_access(mem, cmd, addr, vp, nbytes);
+}
+
+/* system call handler macro */
+#define SYSCALL(INST)	sys_syscall(&regs, bb_mem_access, mem, INST, TRUE)
+#else /* !USE_BB_CACHE */
 /* system call handler macro */
 #define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
+#endif /* USE_BB_CACHE */
 
 #ifndef NO_INSN_COUNT
 #define INC_INSN_CTR()	sim_num_insn++
@@ -308,11 +480,153 @@ sim_uninit(void)
 #define ZERO_FP_REG()	/* nada... */
 #endif
 
+#ifdef IR_DETECT
+/* start the IR-detector record of the instruction about to execute; the
+   dependence decoders are constants of each opcode's dispatch code */
+#define IR_PRE(O1,O2,I1,I2,I3)						\
+  {									\
+    ir_ev.r_out[0] = (O1); ir_ev.r_out[1] = (O2);			\
+    ir_ev.r_in[0] = (I1); ir_ev.r_in[1] = (I2); ir_ev.r_in[2] = (I3);	\
+    IR_SAVE_REG(&regs, ir_ev.r_out[0], ir_ev.out_pre[0]);		\
+    IR_SAVE_REG(&regs, ir_ev.r_out[1], ir_ev.out_pre[1]);		\
+  }
+
+/* complete the record of the instruction just executed and hand it to the
+   IR detector; only memory instructions set the _mem_* variables, so only
+   they need to clear them */
+static void
+ir_retire(enum md_opcode op)
+{
+  ir_ev.op = op;
+  ir_ev.pc = regs.regs_PC;
+  ir_ev.next_pc = regs.regs_NPC;
+  IR_SAVE_REG(&regs, ir_ev.r_out[0], ir_ev.out_post[0]);
+  IR_SAVE_REG(&regs, ir_ev.r_out[1], ir_ev.out_post[1]);
+  ir_ev.load_addr[0] = _mem_load_addr_0;
+  ir_ev.load_addr[1] = _mem_load_addr_1;
+  ir_ev.store_addr[0] = _mem_store_addr_0;
+  ir_ev.store_addr[1] = _mem_store_addr_1;
+  ir_ev.store_old[0] = _mem_store_old_word_0;
+  ir_ev.store_old[1] = _mem_store_old_word_1;
+  ir_ev.store_new[0] = _mem_store_new_word_0;
+  ir_ev.store_new[1] = _mem_store_new_word_1;
+  process_new_instr(&ir_ev);
+
+  if (MD_OP_FLAGS(op) & F_MEM)
+    {
+      _mem_load_addr_0 = _mem_load_addr_1 = 0;
+      _mem_store_addr_0 = _mem_store_addr_1 = 0;
+      _mem_store_new_word_0 = _mem_store_new_word_1 = 0;
+      _mem_store_old_word_0 = _mem_store_old_word_1 = 0;
+    }
+}
+#define IR_RETIRE(OP)		ir_retire(OP)
+#else /* !IR_DETECT */
+#define IR_PRE(O1,O2,I1,I2,I3)	/* nada */
+#define IR_RETIRE(OP)		/* nada */
+#endif /* IR_DETECT */
+
+#ifdef USE_BB_CACHE
+/* drop all translations */
+static void
+bb_flush(void)
+{
+  int i;
+  struct bb_block *blk, *next;
+
+  for (i=0; i < BB_HASH_SIZE; i++)
+    {
+      for (blk = bb_table[i]; blk; blk = next)
+	{
+	  next = blk->next;
+	  free(blk);
+	}
+      bb_table[i] = NULL;
+    }
+  bb_flushes++;
+  bb_stale = FALSE;
+}
+
+/* translate the basic block at PC, HANDLERS maps opcodes to their handlers */
+static struct bb_block *
+bb_translate(md_addr_t PC, void **handlers)
+{
+  struct bb_insn buf[BB_MAX_INSNS];
+  struct bb_block *blk;
+  md_inst_t inst;
+  enum md_opcode op;
+  md_addr_t addr = PC;
+  int n = 0;
+
+  do
+    {
+      MD_FETCH_INST(inst, mem, addr);
+      MD_SET_OPCODE(op, inst);
+      /* bogus opcodes go to the NA handler */
+      buf[n].handler = handlers[op < OP_MAX ? op : OP_NA];
+      buf[n].inst = inst;
+      n++;
+      addr += sizeof(md_inst_t);
+    }
+  while (n < BB_MAX_INSNS
+	 && !(op < OP_MAX && (MD_OP_FLAGS(op) & (F_CTRL|F_TRAP)))
+	 && addr - ld_text_base < ld_text_size);
+
+  blk = (struct bb_block *)
+    malloc(sizeof(struct bb_block) + (n - 1) * sizeof(struct bb_insn));
+  if (!blk)
+    fatal("out of virtual memory");
+  blk->pc = PC;
+  blk->ninsn = n;
+  memcpy(blk->insn, buf, n * sizeof(struct bb_insn));
+  blk->next = bb_table[BB_HASH(PC)];
+  bb_table[BB_HASH(PC)] = blk;
+  bb_translations++;
+
+  return blk;
+}
+
+/* find the translation of the basic block at PC, translating it if needed */
+static struct bb_block *
+bb_lookup(md_addr_t PC, void **handlers)
+{
+  struct bb_block *blk;
+
+  if (bb_stale)
+    bb_flush();
+
+  for (blk = bb_table[BB_HASH(PC)]; blk; blk = blk->next)
+    {
+      if (blk->pc == PC)
+	return blk;
+    }
+  return bb_translate(PC, handlers);
+}
+#endif /* USE_BB_CACHE */
+
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
 {
-#ifdef USE_JUMP_TABLE
+#if defined(USE_BB_CACHE)
+  /* handler of each opcode in the block cache interpreter, GNU GCC specific
+     like the jump table below */
+  static void *bb_handlers[/* max opcodes */] = {
+    &&bb_NA, /* NA */
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+    &&bb_##OP,
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    &&bb_##OP,
+#define CONNECT(OP)
+#include "machine.def"
+  };
+
+  /* current block: next instruction to execute and end of the block */
+  register struct bb_insn *bb_ip;
+  struct bb_insn *bb_end;
+  struct bb_block *blk;
+
+#elif defined(USE_JUMP_TABLE)
   /* the jump table employs GNU GCC label extensions to construct an array
      of pointers to instruction implementation code, the simulator then uses
      the table to lookup the location of instruction's implementing code, a
@@ -331,13 +645,15 @@ sim_main(void)
 #define CONNECT(OP)
 #include "machine.def"
   };
-#endif /* USE_JUMP_TABLE */
+#endif /* USE_BB_CACHE || USE_JUMP_TABLE */
 
   /* register allocate instruction buffer */
   register md_inst_t inst;
 
+#ifndef USE_BB_CACHE
   /* decoded opcode */
   register enum md_opcode op;
+#endif /* !USE_BB_CACHE */
 
   fprintf(stderr, "sim: ** starting *fast* functional simulation **\n");
 
@@ -345,7 +661,67 @@ sim_main(void)
   if (sim_swap_bytes || sim_swap_words)
     fatal("sim: *fast* functional simulation cannot swap bytes or words");
 
-#ifdef USE_JUMP_TABLE
+#ifdef IR_DETECT
+  /* default window size 32M */
+  if (window_size == 0)
+    window_size = 32000000;
+
+  ir_detector_setup(window_size, ir_ring_size, ir_top > 0);
+#endif /* IR_DETECT */
+
+#if defined(USE_BB_CACHE)
+
+  /* every block starts at the NPC of the last instruction executed */
+  regs.regs_NPC = regs.regs_PC;
+
+ bb_dispatch:
+  blk = bb_lookup(regs.regs_NPC, bb_handlers);
+  bb_ip = blk->insn;
+  bb_end = bb_ip + blk->ninsn;
+  goto *bb_ip->handler;
+
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+  bb_##OP:								\
+    /* maintain $r0 semantics */					\
+    regs.regs_R[MD_REG_ZERO] = 0;					\
+    ZERO_FP_REG();							\
+									\
+    /* keep an instruction count */					\
+    INC_INSN_CTR();							\
+									\
+    /* locate next instruction */					\
+    regs.regs_PC = regs.regs_NPC;					\
+									\
+    /* set up default next PC */					\
+    regs.regs_NPC += sizeof(md_inst_t);					\
+									\
+    /* execute the instruction */					\
+    inst = bb_ip->inst;							\
+    IR_PRE(O1,O2,I1,I2,I3);						\
+    SYMCAT(OP,_IMPL);							\
+    IR_RETIRE(OP);							\
+									\
+    /* only the last instruction of a block can leave it */		\
+    if (++bb_ip < bb_end)						\
+      goto *bb_ip->handler;						\
+    goto bb_dispatch;
+
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+  bb_##OP:								\
+    panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+/* there is no enclosing switch to break out of here */
+#define DECLARE_FAULT(FAULT)						\
+	  { /* uncaught... */ }
+#include "machine.def"
+
+  bb_NA:
+    panic("attempted to execute a bogus opcode");
+
+  /* should not get here... */
+  panic("exited sim-fast main loop");
+
+#elif defined(USE_JUMP_TABLE)
 
   regs.regs_NPC = regs.regs_PC;
 
@@ -372,7 +748,9 @@ sim_main(void)
     regs.regs_NPC += sizeof(md_inst_t);					\
 									\
     /* execute the instruction */					\
+    IR_PRE(O1,O2,I1,I2,I3);						\
     SYMCAT(OP,_IMPL);							\
+    IR_RETIRE(OP);							\
 									\
     /* get the next instruction */					\
     MD_FETCH_INST(inst, mem, regs.regs_NPC);				\
@@ -385,8 +763,9 @@ sim_main(void)
   opcode_##OP:								\
     panic("attempted to execute a linking opcode");
 #define CONNECT(OP)
+/* there is no enclosing switch to break out of here */
 #define DECLARE_FAULT(FAULT)						\
-	  { /* uncaught... */break; }
+	  { /* uncaught... */ }
 #include "machine.def"
 
   opcode_NA:
@@ -395,7 +774,7 @@ sim_main(void)
   /* should not get here... */
   panic("exited sim-fast main loop");
 
-#else /* !USE_JUMP_TABLE */
+#else /* !USE_BB_CACHE && !USE_JUMP_TABLE */
 
   /* set up initial default next PC */
   regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
@@ -431,7 +810,9 @@ sim_main(void)
 	{
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
 	case OP:							\
+	  IR_PRE(O1,O2,I1,I2,I3);					\
 	  SYMCAT(OP,_IMPL);						\
+	  IR_RETIRE(OP);						\
 	  break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
 	case OP:							\
@@ -449,5 +830,5 @@ sim_main(void)
       regs.regs_NPC += sizeof(md_inst_t);
     }
 
-#endif /* USE_JUMP_TABLE */
+#endif /* USE_BB_CACHE || USE_JUMP_TABLE */
 }
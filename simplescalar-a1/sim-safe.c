@@ -64,6 +64,7 @@
 #include "stats.h"
 #include "sim.h"
 #include "ir_detector.h"
+#include "ir_counters.h"
 
 /* IDENTIFYING INSTRUCTIONS */
 
@@ -116,7 +117,6 @@
 
 /* simulated registers */
 static struct regs_t regs;
-struct regs_t p_regs;
 
 /* simulated memory */
 static struct mem_t *mem = NULL;
@@ -124,31 +124,18 @@ static struct mem_t *mem = NULL;
 /* track number of refs */
 static counter_t sim_num_refs = 0;
 
-
-/* track number of non-modifying register writes */
-counter_t sim_reg_nmod_wr = 0;
-
-/* track number of non-modifying register writes */
-counter_t sim_reg_uref_wr = 0;
-
-/* track number of non-modifying register writes */
-counter_t sim_inef_br = 0;
-
-/* track number of transitive ineffectual instructions */
-counter_t sim_transitive_ineff = 0;
-
-/* track number of non-modifying memory writes */
-counter_t sim_mem_nmod_wr = 0;
-
-/* track number of unreferenced memory writes */
-counter_t sim_mem_uref_wr = 0;
-
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
 /* instruction window size */
 static unsigned int window_size;
 
+/* IR-detector ring size (records); 0 runs the detector inline */
+static unsigned int ir_ring_size;
+
+/* PCs listed per kind of ineffectual instance; 0 disables the report */
+static unsigned int ir_top;
+
 /* register simulator-specific options */
 void
 sim_reg_options(struct opt_odb_t *odb)
@@ -171,6 +158,17 @@ sim_reg_options(struct opt_odb_t *odb)
 	       &window_size, /* default */0,
 	       /* print */TRUE, /* format */NULL);
 
+  /* decoupled IR detector */
+  opt_reg_uint(odb, "-ir:ring", "records buffered for a separate IR-detector "
+	       "thread (0: run the detector inline)",
+	       &ir_ring_size, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_uint(odb, "-ir:top", "report the PCs with the most ineffectual "
+	       "instances of each kind (0: no report)",
+	       &ir_top, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
 }
 
 /* check simulator-specific option values */
@@ -214,6 +212,9 @@ sim_reg_stats(struct stat_sdb_t *sdb)
   stat_reg_counter(sdb, "sim_mem_uref_wr",
 		   "total unreferenced memory writes",
 		   &sim_mem_uref_wr, 0, NULL);
+  stat_reg_counter(sdb, "sim_ineff_worklist_peak",
+		   "peak producer worklist depth of transitive checks",
+		   &sim_ineff_worklist_peak, 0, NULL);
 
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
@@ -257,7 +258,8 @@ sim_aux_config(FILE *stream)		/* output stream */
 void
 sim_aux_stats(FILE *stream)		/* output stream */
 {
-  /* nada */
+  if (ir_top)
+    ir_detector_print_top(stream, ir_top);
 }
 
 /* un-initialize simulator-specific state */
@@ -365,8 +367,8 @@ sim_uninit(void)
 /* system call handler macro */
 #define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
 
-//target register numbers and source registers
-int r_out[2], r_in[3];
+//retirement record of the current instruction for the IR detector
+static struct ir_event ir_ev;
 
 md_addr_t _mem_load_addr_0;
 md_addr_t _mem_load_addr_1;
@@ -403,7 +405,7 @@ sim_main(void)
   if(window_size == 0)
    window_size = 32000000;
 
-  ir_detector_setup(window_size);
+  ir_detector_setup(window_size, ir_ring_size, ir_top > 0);
   while (TRUE)
     {
 
@@ -428,9 +430,6 @@ sim_main(void)
       /* decode the instruction */
       MD_SET_OPCODE(op, inst);
 
-      /* copy regfile before executing the instruction */
-      p_regs = regs;
-
       _mem_load_addr_0 = 0;
       _mem_load_addr_1 = 0;
 
@@ -447,8 +446,10 @@ sim_main(void)
 	{
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
 	case OP:							\
-          r_out[0] = (O1); r_out[1] = (O2);				\
-          r_in[0] = (I1); r_in[1] = (I2); r_in[2] = (I3);		\
+          ir_ev.r_out[0] = (O1); ir_ev.r_out[1] = (O2);		\
+          ir_ev.r_in[0] = (I1); ir_ev.r_in[1] = (I2); ir_ev.r_in[2] = (I3);	\
+          IR_SAVE_REG(&regs, ir_ev.r_out[0], ir_ev.out_pre[0]);		\
+          IR_SAVE_REG(&regs, ir_ev.r_out[1], ir_ev.out_pre[1]);		\
           SYMCAT(OP,_IMPL);						\
           break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
@@ -490,7 +491,20 @@ sim_main(void)
 	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
 
       /* run ir_detector */
-      process_new_instr(op, &regs, &p_regs, r_in, r_out, regs.regs_PC, regs.regs_NPC);
+      ir_ev.op = op;
+      ir_ev.pc = regs.regs_PC;
+      ir_ev.next_pc = regs.regs_NPC;
+      IR_SAVE_REG(&regs, ir_ev.r_out[0], ir_ev.out_post[0]);
+      IR_SAVE_REG(&regs, ir_ev.r_out[1], ir_ev.out_post[1]);
+      ir_ev.load_addr[0] = _mem_load_addr_0;
+      ir_ev.load_addr[1] = _mem_load_addr_1;
+      ir_ev.store_addr[0] = _mem_store_addr_0;
+      ir_ev.store_addr[1] = _mem_store_addr_1;
+      ir_ev.store_old[0] = _mem_store_old_word_0;
+      ir_ev.store_old[1] = _mem_store_old_word_1;
+      ir_ev.store_new[0] = _mem_store_new_word_0;
+      ir_ev.store_new[1] = _mem_store_new_word_1;
+      process_new_instr(&ir_ev);
       
       /* go to the next instruction */
       regs.regs_PC = regs.regs_NPC;